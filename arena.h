@@ -0,0 +1,154 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * The Arena class.
+ * A bump allocator: memory is handed out from large blocks by moving a cursor, and is
+ * only given back all at once, when the arena is destroyed. Objects made in an arena
+ * are never destroyed one by one, so they must be trivially destructible, and may
+ * only point to other memory of the same arena.
+ *
+ * Freeing the arena costs one delete per block, however many objects were made in it.
+ */
+class Arena {
+
+	private:
+		// Size of a block. Larger allocations get a block of their own.
+		static const size_t BLOCK_SIZE = 1 << 16;
+
+		vector<char*> blocks;
+		// Free space in the current block
+		char* cursor;
+		char* limit;
+		// Number of bytes handed out
+		size_t used;
+		// Arenas owned by this one
+		vector<Arena*> adopted;
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+	public:
+		Arena() {
+			this->cursor = NULL;
+			this->limit = NULL;
+			this->used = 0;
+		}
+
+		~Arena() {
+			for ( size_t i = 0; i < this->blocks.size(); i++ ) {
+				delete[] this->blocks[i];
+			}
+			for ( size_t i = 0; i < this->adopted.size(); i++ ) {
+				delete this->adopted[i];
+			}
+		}
+
+		/**
+		 * Returns size bytes, aligned to the given alignment (a power of 2).
+		 */
+		void* allocate(size_t size, size_t align = alignof(max_align_t)) {
+			uintptr_t p = ( (uintptr_t) this->cursor + align - 1 ) & ~(uintptr_t) ( align - 1 );
+			if ( this->cursor == NULL || p + size > (uintptr_t) this->limit ) {
+				if ( size > BLOCK_SIZE / 4 ) {
+					// Large allocations get a block of their own, kept in front of the
+					// others so that the rest of the current block can still be used
+					char* block = new char[size];
+					this->blocks.insert( this->blocks.begin(), block );
+					this->used += size;
+					return block;
+				}
+				char* block = new char[BLOCK_SIZE];
+				this->blocks.push_back(block);
+				this->cursor = block;
+				this->limit = block + BLOCK_SIZE;
+				p = ( (uintptr_t) this->cursor + align - 1 ) & ~(uintptr_t) ( align - 1 );
+			}
+			this->cursor = (char*) ( p + size );
+			this->used += size;
+			return (void*) p;
+		}
+
+		/**
+		 * Makes an object in the arena.
+		 */
+		template<class T, class... Args>
+		T* make(Args&&... args) {
+			static_assert( is_trivially_destructible<T>::value, "Arena objects are never destroyed" );
+			return new ( this->allocate( sizeof(T), alignof(T) ) ) T( forward<Args>(args)... );
+		}
+
+		/**
+		 * Returns an uninitialized array of n objects of type T.
+		 */
+		template<class T>
+		T* array(size_t n) {
+			static_assert( is_trivially_destructible<T>::value, "Arena objects are never destroyed" );
+			return (T*) this->allocate( n * sizeof(T), alignof(T) );
+		}
+
+		/**
+		 * Copies a string into the arena, and terminates it with a NUL character.
+		 */
+		const char* copy(const char* s, size_t length) {
+			char* p = (char*) this->allocate( length + 1, 1 );
+			memcpy(p, s, length);
+			p[length] = '\0';
+			return p;
+		}
+
+		/**
+		 * Gives back all the memory of the arena at once. Objects made in it must no
+		 * longer be used.
+		 */
+		void reset() {
+			// Keep the current block, which is the last one, for reuse
+			char* keep = ( this->cursor != NULL )? this->blocks.back() : NULL;
+			for ( size_t i = 0; i < this->blocks.size(); i++ ) {
+				if ( this->blocks[i] != keep ) {
+					delete[] this->blocks[i];
+				}
+			}
+			this->blocks.clear();
+			if ( keep != NULL ) {
+				this->blocks.push_back(keep);
+				this->cursor = keep;
+			}
+			this->used = 0;
+			for ( size_t i = 0; i < this->adopted.size(); i++ ) {
+				delete this->adopted[i];
+			}
+			this->adopted.clear();
+		}
+
+		/**
+		 * Takes ownership of another arena, so that the objects made in it live as long
+		 * as this one. The other arena is deleted along with this one, or when this one
+		 * is reset.
+		 */
+		void adopt(Arena* other) {
+			this->adopted.push_back(other);
+		}
+
+		// Returns the number of bytes handed out
+		size_t size() {
+			size_t size = this->used;
+			for ( size_t i = 0; i < this->adopted.size(); i++ ) {
+				size += this->adopted[i]->size();
+			}
+			return size;
+		}
+};
+
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef __AST_CACHE_H__
+#define __AST_CACHE_H__
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source-buffer.h"
+#include "symbol-table.h"
+#include "flat-ast.h"
+#include "lexer.h"
+#include "parser.h"
+
+using namespace std;
+
+/**
+ * The ASTCache class.
+ * Keeps the trees of parsed sources in a directory, in the binary form of
+ * FlatAST::toBytes(), so that a source parsed before is loaded instead of lexed and
+ * parsed again.
+ *
+ * A tree is filed under a hash of the source bytes, the source size and the parser
+ * version (Parser::VERSION), so that an edited source, or a source parsed by another
+ * version of the parser, misses. Since two sources may share a hash and a size, each
+ * file starts with a second, independent hash of its source (FNV-1a), which is checked
+ * before the tree is trusted. Trees are written to a temporary file, then renamed,
+ * so that several processes can share a directory, and never read a partial tree.
+ */
+class ASTCache {
+
+	private:
+		string directory;
+
+		ASTCache(const ASTCache&) = delete;
+		ASTCache& operator=(const ASTCache&) = delete;
+
+	public:
+		/**
+		 * Creates a cache in the given directory, which is created when a tree is first
+		 * stored, if it does not exist.
+		 */
+		ASTCache(string directory) {
+			this->directory = directory;
+		}
+
+		/**
+		 * Returns a 64-bit hash of the given bytes, read 8 at a time.
+		 */
+		static uint64_t hash(const char* s, size_t length) {
+			const uint64_t m = 0x9E3779B97F4A7C15ULL;
+			uint64_t h = length * m;
+			size_t i = 0;
+			for ( ; i + 8 <= length; i += 8 ) {
+				uint64_t w;
+				memcpy(&w, s + i, 8);
+				h = ( h ^ w ) * m;
+				h ^= h >> 29;
+			}
+			uint64_t w = 0;
+			memcpy(&w, s + i, length - i);
+			h = ( h ^ w ) * m;
+			h ^= h >> 32;
+			return h;
+		}
+
+		/**
+		 * Returns the FNV-1a hash of the given bytes, which is stored in the file of a
+		 * tree, to tell apart sources that hash() files together.
+		 */
+		static uint64_t check(const char* s, size_t length) {
+			uint64_t h = 0xCBF29CE484222325ULL;
+			for ( size_t i = 0; i < length; i++ ) {
+				h = ( h ^ (uint8_t) s[i] ) * 0x100000001B3ULL;
+			}
+			return h;
+		}
+
+		/**
+		 * Returns the path of the tree of the given source.
+		 */
+		string pathOf(SourceBuffer* source) {
+			char name[64];
+			snprintf( name, sizeof(name), "%016llx-%llx-%u.ast",
+				(unsigned long long) ASTCache::hash( source->data(), source->size() ),
+				(unsigned long long) source->size(), (unsigned) Parser::VERSION );
+			return this->directory + "/" + name;
+		}
+
+		/**
+		 * Returns the cached tree of the given source, or NULL if there is none, or the
+		 * file is of another source or is corrupted. The symbol IDs of identifiers are looked up in the given table, or if there is
+		 * none, left unset.
+		 */
+		FlatAST* load(SourceBuffer* source, SymbolTable* symbols = NULL) {
+			int fd = open( this->pathOf(source).c_str(), O_RDONLY );
+			if ( fd < 0 ) {
+				return NULL;
+			}
+			FlatAST* flat = NULL;
+			struct stat st;
+			if ( fstat(fd, &st) == 0 && st.st_size > (off_t) sizeof(uint64_t) ) {
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if ( m != MAP_FAILED ) {
+					uint64_t stored;
+					memcpy( &stored, m, sizeof(stored) );
+					if ( stored == ASTCache::check( source->data(), source->size() ) ) {
+						flat = FlatAST::fromBytes( (const char*) m + sizeof(stored), st.st_size - sizeof(stored) );
+					}
+					munmap(m, st.st_size);
+				}
+			}
+			close(fd);
+			if ( flat != NULL ) {
+				flat->internSymbols(symbols);
+			}
+			return flat;
+		}
+
+		/**
+		 * Stores the tree of the given source. Returns false if it could not be written.
+		 */
+		bool store(SourceBuffer* source, FlatAST* flat) {
+			if ( mkdir( this->directory.c_str(), 0777 ) != 0 && errno != EEXIST ) {
+				return false;
+			}
+			string bytes;
+			uint64_t check = ASTCache::check( source->data(), source->size() );
+			bytes.append( (const char*) &check, sizeof(check) );
+			flat->toBytes(bytes);
+
+			string path = this->pathOf(source);
+			string temporary = path + ".tmp." + to_string( getpid() );
+			int fd = open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+			if ( fd < 0 ) {
+				return false;
+			}
+			size_t written = 0;
+			while ( written < bytes.size() ) {
+				ssize_t n = write( fd, bytes.data() + written, bytes.size() - written );
+				if ( n < 0 && errno == EINTR ) {
+					continue;
+				}
+				if ( n <= 0 ) {
+					break;
+				}
+				written += n;
+			}
+			bool ok = ( close(fd) == 0 ) && ( written == bytes.size() );
+			if ( !ok || rename( temporary.c_str(), path.c_str() ) != 0 ) {
+				unlink( temporary.c_str() );
+				return false;
+			}
+			return true;
+		}
+
+		/**
+		 * Returns the tree of the given source: the cached one if there is one, or else
+		 * a new one, from Parser::parseFlat(), which is then stored. Identifiers get
+		 * their symbol IDs from the given table, if any. Throws a ParseException if
+		 * the source is not valid; errors are not cached.
+		 */
+		FlatAST* parse(SourceBuffer* source, SymbolTable* symbols = NULL) {
+			FlatAST* flat = this->load(source, symbols);
+			if ( flat != NULL ) {
+				return flat;
+			}
+
+			Lexer lexer(source);
+			lexer.setSymbolTable(symbols);
+			lexer.generateTokens();
+			Parser parser(&lexer);
+			flat = parser.parseFlat();
+			if ( !lexer.hasFailed() ) {
+				this->store(source, flat);
+			}
+			return flat;
+		}
+};
+
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef __AST_VISITOR_H__
+#define __AST_VISITOR_H__
+
+#include <vector>
+#include <utility>
+#include "astnode.h"
+
+using namespace std;
+
+/**
+ * The ASTVisitor class.
+ * Walks a tree, calling a hook before (enter) and after (leave) the children of each
+ * node. A pass derives from ASTVisitor<Pass> and declares the hooks it needs, either
+ * for one node class, e.g.
+ *
+ *     bool enterFuncDecl(FuncDeclNode* node);
+ *     void leaveFuncDecl(FuncDeclNode* node);
+ *
+ * or for every node, with enter(ASTNode*) and leave(ASTNode*), which are what the
+ * class hooks call by default. Hooks are found at compile time, and nodes are told
+ * apart by their kind, so a pass costs no virtual call or RTTI per node.
+ *
+ * If enter returns false, the children of the node are skipped, and leave is not
+ * called for it.
+ *
+ * walk() recurses once per level of the tree. walkIterative() keeps its own stack
+ * instead, for trees too deep for the native stack, such as long left associative
+ * operator chains.
+ */
+template<class Pass>
+class ASTVisitor {
+
+	private:
+		// Stack of (node, index of the next child to visit), for walkIterative()
+		vector< pair<ASTNode*, uint32_t> > stack;
+
+		Pass* pass() {
+			return static_cast<Pass*>(this);
+		}
+
+		bool dispatchEnter(ASTNode* node) {
+			switch( node->getKind() ) {
+				#define X(Name, Class, Kind) \
+					case Kind: return this->pass()->enter##Name( static_cast<Class*>(node) );
+				AST_NODE_CLASSES(X)
+				#undef X
+				default: return this->pass()->enter(node);
+			}
+		}
+
+		void dispatchLeave(ASTNode* node) {
+			switch( node->getKind() ) {
+				#define X(Name, Class, Kind) \
+					case Kind: this->pass()->leave##Name( static_cast<Class*>(node) ); break;
+				AST_NODE_CLASSES(X)
+				#undef X
+				default: this->pass()->leave(node); break;
+			}
+		}
+
+	public:
+		// Hooks for every node
+		bool enter(ASTNode*) {
+			return true;
+		}
+		void leave(ASTNode*) {}
+
+		// Hooks for each node class
+		#define X(Name, Class, Kind) \
+			bool enter##Name(Class* node) { return this->pass()->enter(node); } \
+			void leave##Name(Class* node) { this->pass()->leave(node); }
+		AST_NODE_CLASSES(X)
+		#undef X
+
+		/**
+		 * Walks the tree under the given node, recursively.
+		 */
+		void walk(ASTNode* node) {
+			if ( !this->dispatchEnter(node) ) {
+				return;
+			}
+			for ( size_t i = 0; i < node->getChildCount(); i++ ) {
+				this->walk( node->getChild(i) );
+			}
+			this->dispatchLeave(node);
+		}
+
+		/**
+		 * Walks the tree under the given node in the same order as walk(), with an
+		 * explicit stack.
+		 */
+		void walkIterative(ASTNode* root) {
+			if ( !this->dispatchEnter(root) ) {
+				return;
+			}
+			this->stack.clear();
+			this->stack.push_back( make_pair(root, 0) );
+			while ( !this->stack.empty() ) {
+				ASTNode* node = this->stack.back().first;
+				uint32_t next = this->stack.back().second;
+
+				if ( next < node->getChildCount() ) {
+					// Enter the next child
+					this->stack.back().second++;
+					ASTNode* child = node->getChild(next);
+					if ( this->dispatchEnter(child) ) {
+						this->stack.push_back( make_pair(child, 0) );
+					}
+				} else {
+					// All children visited
+					this->stack.pop_back();
+					this->dispatchLeave(node);
+				}
+			}
+		}
+};
+
+
+#endif
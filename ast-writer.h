@@ -0,0 +1,300 @@
+#ifndef __AST_WRITER_H__
+#define __AST_WRITER_H__
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstring>
+#include <cstdio>
+#include <cinttypes>
+#include "astnode.h"
+
+using namespace std;
+
+/**
+ * The ASTWriter class.
+ * Writes a tree to an output stream, in one of these formats:
+ *
+ *  - XML: the format of ASTNode::toString(), one node per line, indented by tabs
+ *  - JSON: {"kind":"Add","children":[...]}, or {"kind":"Identifier","text":"x"}
+ *    for nodes with text, without spaces. Literals also have their value, as in
+ *    {"kind":"StringLiteral","text":"\"a\\tb\"","value":"a\tb"}
+ *  - SEXPR: (Add (Identifier x) (IntegerLiteral 1)), without new lines
+ *
+ * The tree is walked with an explicit stack, and the text goes into a buffer that
+ * is written out when full, so that writing costs no allocation per node, and
+ * deep trees do not use deep native stacks. (The writer does not use ASTVisitor,
+ * as ASTNode::toString() is defined here, and astnode.h must not need the visitor.)
+ */
+class ASTWriter {
+
+	public:
+		enum Format {
+			XML,
+			JSON,
+			SEXPR
+		};
+
+	private:
+		static const size_t BUFFER_SIZE = 1 << 16;
+
+		ostream* out;
+		Format format;
+		vector<char> buffer;
+		size_t used;
+		// Written at the start of each XML line, before the tabs
+		string prefix;
+		// Depth of the node being written
+		size_t depth;
+		// Set if the next node is not the first of its siblings, for JSON commas
+		bool sibling;
+		// Stack of (node, index of the next child to write)
+		vector< pair<ASTNode*, uint32_t> > stack;
+
+		ASTWriter(const ASTWriter&) = delete;
+		ASTWriter& operator=(const ASTWriter&) = delete;
+
+		void put(const char* s, size_t length) {
+			if ( this->used + length > this->buffer.size() ) {
+				this->flush();
+				if ( length > this->buffer.size() ) {
+					this->out->write(s, length);
+					return;
+				}
+			}
+			memcpy( this->buffer.data() + this->used, s, length );
+			this->used += length;
+		}
+		void put(const char* s) {
+			this->put( s, strlen(s) );
+		}
+		void put(char c) {
+			if ( this->used == this->buffer.size() ) {
+				this->flush();
+			}
+			this->buffer[ this->used++ ] = c;
+		}
+
+		// Writes the prefix and the indentation of an XML line
+		void indent() {
+			static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+			this->put( this->prefix.data(), this->prefix.length() );
+			for ( size_t n = this->depth; n > 0; ) {
+				size_t k = ( n < sizeof(tabs) - 1 )? n : sizeof(tabs) - 1;
+				this->put(tabs, k);
+				n -= k;
+			}
+		}
+
+		// Writes text as the contents of a JSON string
+		void putEscaped(const char* s, size_t length) {
+			static const char hex[] = "0123456789abcdef";
+			size_t start = 0;
+			for ( size_t i = 0; i < length; i++ ) {
+				unsigned char c = s[i];
+				if ( c != '"' && c != '\\' && c >= 0x20 ) {
+					continue;
+				}
+				this->put( s + start, i - start );
+				start = i + 1;
+				switch( c ) {
+					case '"':	this->put("\\\"", 2);	break;
+					case '\\':	this->put("\\\\", 2);	break;
+					case '\n':	this->put("\\n", 2);	break;
+					case '\t':	this->put("\\t", 2);	break;
+					case '\r':	this->put("\\r", 2);	break;
+					default: {
+						char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+						this->put(u, 6);
+					}
+				}
+			}
+			this->put( s + start, length - start );
+		}
+
+		// Writes the value of a literal as a JSON value
+		void putLiteral(NodeKind kind, const Literal& value) {
+			char number[32];
+			switch( kind ) {
+				case NK_INTEGER_LITERAL:
+					this->put( number, snprintf( number, sizeof(number), "%" PRId64, value.integer ) );
+					break;
+				case NK_REAL_LITERAL:
+					this->put( number, snprintf( number, sizeof(number), "%.17g", value.real ) );
+					break;
+				case NK_CHAR_LITERAL:
+					this->put('"');
+					this->putEscaped( &value.character, 1 );
+					this->put('"');
+					break;
+				case NK_STRING_LITERAL:
+					this->put('"');
+					this->putEscaped( value.text, value.length );
+					this->put('"');
+					break;
+				case NK_BOOLEAN_LITERAL:
+					this->put( value.integer? "true" : "false" );
+					break;
+				default:
+					this->put("null", 4);
+					break;
+			}
+		}
+
+		// Writes a node, up to its children
+		void open(ASTNode* node) {
+			const char* name = node->getName();
+			Literal value;
+			switch( this->format ) {
+				case XML:
+					this->indent();
+					this->put('<');
+					this->put(name);
+					this->put('>');
+					if ( node->getTextLength() == 0 ) {
+						this->put('\n');
+					} else {
+						this->put( node->getText(), node->getTextLength() );
+					}
+					break;
+				case JSON:
+					if ( this->sibling ) {
+						this->put(',');
+					}
+					this->put("{\"kind\":\"", 9);
+					this->put(name);
+					this->put('"');
+					if ( node->getTextLength() != 0 ) {
+						this->put(",\"text\":\"", 9);
+						this->putEscaped( node->getText(), node->getTextLength() );
+						this->put('"');
+					}
+					if ( getLiteral(node, &value) ) {
+						this->put(",\"value\":", 9);
+						this->putLiteral( node->getKind(), value );
+					}
+					if ( node->getChildCount() != 0 ) {
+						this->put(",\"children\":[", 13);
+					}
+					break;
+				case SEXPR:
+					if ( this->depth > 0 ) {
+						this->put(' ');
+					}
+					this->put('(');
+					this->put(name);
+					if ( node->getTextLength() != 0 ) {
+						this->put(' ');
+						this->put( node->getText(), node->getTextLength() );
+					}
+					break;
+			}
+			this->depth++;
+			this->sibling = false;
+		}
+
+		// Writes the end of a node, after its children
+		void close(ASTNode* node) {
+			this->depth--;
+			switch( this->format ) {
+				case XML:
+					if ( node->getTextLength() == 0 ) {
+						this->indent();
+					}
+					this->put("</", 2);
+					this->put( node->getName() );
+					this->put(">\n", 2);
+					break;
+				case JSON:
+					if ( node->getChildCount() != 0 ) {
+						this->put(']');
+					}
+					this->put('}');
+					break;
+				case SEXPR:
+					this->put(')');
+					break;
+			}
+			this->sibling = true;
+		}
+
+	public:
+		/**
+		 * Creates a writer to the given stream.
+		 */
+		ASTWriter(ostream& out, Format format = XML) {
+			this->out = &out;
+			this->format = format;
+			this->buffer.resize(BUFFER_SIZE);
+			this->used = 0;
+			this->depth = 0;
+			this->sibling = false;
+		}
+		~ASTWriter() {
+			this->flush();
+		}
+
+		/**
+		 * Sets the text written at the start of each line, in the XML format.
+		 */
+		void setPrefix(const string& prefix) {
+			this->prefix = prefix;
+		}
+
+		/**
+		 * Writes the tree under the given node. The text may stay in the buffer until
+		 * flush() is called, or the writer is destroyed.
+		 */
+		void write(ASTNode* root) {
+			this->depth = 0;
+			this->sibling = false;
+			this->stack.clear();
+			this->open(root);
+			this->stack.push_back( make_pair(root, 0) );
+			while ( !this->stack.empty() ) {
+				ASTNode* node = this->stack.back().first;
+				uint32_t next = this->stack.back().second;
+				if ( next < node->getChildCount() ) {
+					this->stack.back().second++;
+					ASTNode* child = node->getChild(next);
+					this->open(child);
+					this->stack.push_back( make_pair(child, 0) );
+				} else {
+					this->stack.pop_back();
+					this->close(node);
+				}
+			}
+			if ( this->format != XML ) {
+				this->put('\n');
+			}
+		}
+
+		/**
+		 * Writes the buffer to the stream.
+		 */
+		void flush() {
+			if ( this->used > 0 ) {
+				this->out->write( this->buffer.data(), this->used );
+				this->used = 0;
+			}
+		}
+};
+
+
+/**
+ * Returns the tree under the node as a string, written by an ASTWriter.
+ */
+inline string ASTNode::toString(string prefix) {
+	ostringstream ss;
+	{
+		ASTWriter writer(ss);
+		writer.setPrefix(prefix);
+		writer.write(this);
+	}
+	return ss.str();
+}
+
+
+#endif
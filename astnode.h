@@ -7,79 +7,183 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cstring>
+#include <cstdint>
 #include <cxxabi.h>
+#include "symbol-table.h"
+#include "arena.h"
+#include "node-kind.h"
+#include "literal.h"
 
 // Namespace
 using namespace std;
 
 class ASTNode {
 	protected:
-		vector <ASTNode*> children;
-		string name;
-		string text;
+		// The arena the node, its children and its text are allocated in
+		Arena* arena;
+		ASTNode** children;
+		uint32_t count;
+		uint32_t capacity;
+		const char* text;
+		uint32_t length;
+		// The tokens the node was parsed from, [tokenBegin, tokenEnd), and the number
+		// of tokens looked at after them. Only set for statements and blocks.
+		uint32_t tokenBegin;
+		uint32_t tokenEnd;
+		NodeKind kind;
+		unsigned char lookahead;
+		// Lookahead of nodes that looked at too many tokens to count
+		static const unsigned char FAR_LOOKAHEAD = 0xFF;
 	public:
 		// Constructors
-		ASTNode(string name): name(name) {}
-		ASTNode(string name, string text): name(name), text(text) {}
+		ASTNode(Arena* arena, NodeKind kind): arena(arena), children(NULL), count(0), capacity(0), text(""), length(0), tokenBegin(0), tokenEnd(0), kind(kind), lookahead(0) {}
+		ASTNode(Arena* arena, NodeKind kind, const char* text, size_t length): arena(arena), children(NULL), count(0), capacity(0), tokenBegin(0), tokenEnd(0), kind(kind), lookahead(0) {
+			this->text = arena->copy(text, length);
+			this->length = length;
+		}
 
 
 		void addChild(ASTNode* node) {
-			this->children.push_back(node);
+			// Grow the children array. The old array is left in the arena.
+			if ( this->count == this->capacity ) {
+				this->capacity = ( this->capacity == 0 )? 2 : this->capacity * 2;
+				ASTNode** children = this->arena->array<ASTNode*>( this->capacity );
+				if ( this->count > 0 ) {
+					memcpy( children, this->children, this->count * sizeof(ASTNode*) );
+				}
+				this->children = children;
+			}
+			this->children[ this->count++ ] = node;
 		}
-
-		string toString() {
-			return this->toString("");
+		// Replaces the i-th child
+		void setChild(size_t i, ASTNode* node) {
+			this->children[i] = node;
 		}
-		string toString(string prefix) {
-			// Prepare the string
-			stringstream ss;
-			ss << prefix << "<" << this->name << ">";
-
-			// If the node has no text, print a new line char
-			if ( text == "" ) ss << "\n";
-
-			// Print the text is present
-			if ( text != "" ) {
-				ss << text;
+		/**
+		 * Gives the node its own copy of its children array, so that a copy of a node
+		 * can change its children without changing those of the original.
+		 */
+		void copyChildren() {
+			ASTNode** children = this->arena->array<ASTNode*>( this->count );
+			if ( this->count > 0 ) {
+				memcpy( children, this->children, this->count * sizeof(ASTNode*) );
 			}
+			this->children = children;
+			this->capacity = this->count;
+		}
 
-			// Print the children
-			for(vector<ASTNode*>::iterator it = children.begin(); it != children.end(); it++) {
-				ss << (*it)->toString(prefix + "\t");
-			}
+		// Returns the kind of the node
+		NodeKind getKind() {
+			return this->kind;
+		}
+		// Returns the name of the node
+		const char* getName() {
+			return nodeKindName(this->kind);
+		}
+		// Returns the text of the node, or an empty string
+		const char* getText() {
+			return this->text;
+		}
+		// Returns the length of the text
+		size_t getTextLength() {
+			return this->length;
+		}
+		// Returns the number of children
+		size_t getChildCount() {
+			return this->count;
+		}
+		// Returns the i-th child
+		ASTNode* getChild(size_t i) {
+			return this->children[i];
+		}
 
-			// Close the XML node
-			if ( text == "" ) ss << prefix;
-			ss << "</" << this->name << ">\n";
+		/**
+		 * Sets the tokens the node was parsed from: those from begin to end, and up to
+		 * reach, those looked at after them.
+		 */
+		void setTokens(size_t begin, size_t end, size_t reach) {
+			this->tokenBegin = begin;
+			this->tokenEnd = end;
+			this->lookahead = ( reach - end < FAR_LOOKAHEAD )? reach - end : FAR_LOOKAHEAD;
+		}
+		// Returns true if the tokens the node was parsed from are known
+		bool hasTokens() {
+			return this->tokenEnd > this->tokenBegin;
+		}
+		// Returns the position of the first token of the node
+		size_t getTokenBegin() {
+			return this->tokenBegin;
+		}
+		// Returns the position after the last token of the node
+		size_t getTokenEnd() {
+			return this->tokenEnd;
+		}
+		/**
+		 * Returns the position after the last token looked at to parse the node, or
+		 * SIZE_MAX if not known.
+		 */
+		size_t getTokenReach() {
+			return ( this->lookahead != FAR_LOOKAHEAD )? this->tokenEnd + this->lookahead : SIZE_MAX;
+		}
+		/**
+		 * Moves the tokens of the node, and of the statements and blocks in it, by the
+		 * given number of positions.
+		 */
+		void shiftTokens(ptrdiff_t delta) {
+			vector<ASTNode*> stack(1, this);
+			while ( !stack.empty() ) {
+				ASTNode* node = stack.back();
+				stack.pop_back();
+				node->tokenBegin += delta;
+				node->tokenEnd += delta;
+				// Expressions hold no statements
+				for ( uint32_t i = 0; i < node->count; i++ ) {
+					if ( node->children[i]->hasTokens() ) {
+						stack.push_back( node->children[i] );
+					}
+				}
+			}
+		}
 
-			// Return the string
-			return ss.str();
+		string toString() {
+			return this->toString("");
 		}
+		// Defined in ast-writer.h
+		string toString(string prefix);
 };
 
 
 
 // TYPE NODE
 class TypeNode : public ASTNode {
-	public: TypeNode(string type) : ASTNode("Type", type) {}
+	public: TypeNode(Arena* arena, const char* type, size_t length) : ASTNode(arena, NK_TYPE, type, length) {}
 };
 // IDENTIFIER NODE
 class IdentifierNode : public ASTNode {
-	public: IdentifierNode(string iden) : ASTNode("Identifier", iden) {}
+	private: uint32_t symbol;
+	public: IdentifierNode(Arena* arena, const char* iden, size_t length, uint32_t symbol = NO_SYMBOL) : ASTNode(arena, NK_IDENTIFIER, iden, length), symbol(symbol) {}
+	// Returns the symbol ID of the identifier, or NO_SYMBOL if it was not interned
+	uint32_t getSymbol() { return this->symbol; }
 };
 
 
 // FUNC DECL
 class FuncDeclNode : public ASTNode {
-	public: FuncDeclNode() : ASTNode("FunctionDecl"){}
+	private: bool bodyParsed;
+	public: FuncDeclNode(Arena* arena) : ASTNode(arena, NK_FUNC_DECL), bodyParsed(true) {}
+	// Returns false if the body, the last child, is an empty block yet to be parsed
+	// (see Parser::parseBody())
+	bool isBodyParsed() { return this->bodyParsed; }
+	void setBodyParsed(bool parsed) { this->bodyParsed = parsed; }
 };
 // PARAM
 class ParamNode : public ASTNode {
-	public: ParamNode() : ASTNode("Param"){}
+	public: ParamNode(Arena* arena) : ASTNode(arena, NK_PARAM) {}
 };
 // PARAMS
 class ParamsNode : public ASTNode {
-	public: ParamsNode() : ASTNode("Params"){}
+	public: ParamsNode(Arena* arena) : ASTNode(arena, NK_PARAMS) {}
 };
 
 
@@ -88,108 +192,161 @@ class ParamsNode : public ASTNode {
 
 // EXPRESSION
 class ExprNode : public ASTNode {
-	public: ExprNode() : ASTNode("Expression"){}
+	public: ExprNode(Arena* arena) : ASTNode(arena, NK_EXPRESSION) {}
 };
 
 // TYPE CAST
 class TypeCastNode : public ASTNode {
-	public: TypeCastNode() : ASTNode("Params") {}
+	public: TypeCastNode(Arena* arena) : ASTNode(arena, NK_TYPE_CAST) {}
 };
 
 
 // LITERALS
+// The text of a literal is its image; its value is the one decoded by the lexer.
 class IntegerLiteralNode : public ASTNode {
-	public: IntegerLiteralNode(string value) : ASTNode("IntegerLiteral", value) {}
+	private: int64_t integer;
+	public: IntegerLiteralNode(Arena* arena, const char* value, size_t length, int64_t integer = 0) : ASTNode(arena, NK_INTEGER_LITERAL, value, length), integer(integer) {}
+	int64_t getValue() { return this->integer; }
 };
 class RealLiteralNode : public ASTNode {
-	public: RealLiteralNode(string value) : ASTNode("RealLiteral", value) {}
+	private: double real;
+	public: RealLiteralNode(Arena* arena, const char* value, size_t length, double real = 0.0) : ASTNode(arena, NK_REAL_LITERAL, value, length), real(real) {}
+	double getValue() { return this->real; }
 };
 class CharLiteralNode : public ASTNode {
-	public: CharLiteralNode(string value) : ASTNode("CharLiteral", value) {}
+	private: char character;
+	public: CharLiteralNode(Arena* arena, const char* value, size_t length, char character = '\0') : ASTNode(arena, NK_CHAR_LITERAL, value, length), character(character) {}
+	char getValue() { return this->character; }
 };
 class StringLiteralNode : public ASTNode {
-	public: StringLiteralNode(string value) : ASTNode("StringLiteral", value) {}
+	private: const char* str; uint32_t strLength;
+	public: StringLiteralNode(Arena* arena, const char* value, size_t length, const char* str = NULL, size_t strLength = 0) : ASTNode(arena, NK_STRING_LITERAL, value, length) {
+		// A string without escapes is the text between the quotes, and needs no copy
+		if ( str == NULL ) {
+			this->str = ( length >= 2 )? this->text + 1 : this->text;
+			this->strLength = ( length >= 2 )? length - 2 : 0;
+		} else {
+			this->str = arena->copy(str, strLength);
+			this->strLength = strLength;
+		}
+	}
+	// Returns the characters of the string, with the escapes replaced, and their
+	// number. They may not be NUL terminated.
+	const char* getValue() { return this->str; }
+	size_t getValueLength() { return this->strLength; }
 };
 class BooleanLiteralNode : public ASTNode {
-	public: BooleanLiteralNode(string value) : ASTNode("BooleanLiteral", value) {}
+	public: BooleanLiteralNode(Arena* arena, const char* value, size_t length) : ASTNode(arena, NK_BOOLEAN_LITERAL, value, length) {}
 };
 class UnitLiteralNode : public ASTNode {
-	public: UnitLiteralNode(string value) : ASTNode("UnitLiteral", value) {}
-};
+	public: UnitLiteralNode(Arena* arena, const char* value, size_t length) : ASTNode(arena, NK_UNIT_LITERAL, value, length) {}
+};
+
+/**
+ * Sets the value of a literal node and returns true, or returns false if the node is
+ * not a literal. The characters of a string are never NULL. Booleans are the integer
+ * 1 or 0, and the unit literal is 0.
+ */
+inline bool getLiteral(ASTNode* node, Literal* value) {
+	value->length = 0;
+	switch( node->getKind() ) {
+		case NK_INTEGER_LITERAL:
+			value->integer = static_cast<IntegerLiteralNode*>(node)->getValue();
+			return true;
+		case NK_REAL_LITERAL:
+			value->real = static_cast<RealLiteralNode*>(node)->getValue();
+			return true;
+		case NK_CHAR_LITERAL:
+			value->character = static_cast<CharLiteralNode*>(node)->getValue();
+			return true;
+		case NK_STRING_LITERAL:
+			value->text = static_cast<StringLiteralNode*>(node)->getValue();
+			value->length = static_cast<StringLiteralNode*>(node)->getValueLength();
+			return true;
+		case NK_BOOLEAN_LITERAL:
+			value->integer = ( node->getTextLength() == 4 && memcmp( node->getText(), "true", 4 ) == 0 );
+			return true;
+		case NK_UNIT_LITERAL:
+			value->integer = 0;
+			return true;
+		default:
+			return false;
+	}
+}
 
 
 // FUNCTION CALL
 class FuncCallNode : public ASTNode {
-	public: FuncCallNode() : ASTNode("FunctionCall") {}
+	public: FuncCallNode(Arena* arena) : ASTNode(arena, NK_FUNC_CALL) {}
 };
 class FuncParamsNode : public ASTNode {
-	public: FuncParamsNode() : ASTNode("Params") {}
+	public: FuncParamsNode(Arena* arena) : ASTNode(arena, NK_FUNC_PARAMS) {}
 };
 
 
 
 class UnaryNode : public ASTNode {
-	public: UnaryNode() : ASTNode("Unary") {}
+	public: UnaryNode(Arena* arena) : ASTNode(arena, NK_UNARY) {}
 };
 class UnaryOpNode : public ASTNode {
-	public: UnaryOpNode(string op) : ASTNode("UnaryOp", op) {}
+	public: UnaryOpNode(Arena* arena, const char* op, size_t length) : ASTNode(arena, NK_UNARY_OP, op, length) {}
 };
 
 
 
 // ARITHMETIC OPERATOR NODES
 class PlusNode : public ASTNode {
-	public: PlusNode() : ASTNode("Add") {}
+	public: PlusNode(Arena* arena) : ASTNode(arena, NK_PLUS) {}
 };
 class MinusNode : public ASTNode {
-	public: MinusNode() : ASTNode("Subt") {}
+	public: MinusNode(Arena* arena) : ASTNode(arena, NK_MINUS) {}
 };
 class MultiplyNode : public ASTNode {
-	public: MultiplyNode() : ASTNode("Mult") {}
+	public: MultiplyNode(Arena* arena) : ASTNode(arena, NK_MULTIPLY) {}
 };
 class DivideNode : public ASTNode {
-	public: DivideNode() : ASTNode("Div") {}
+	public: DivideNode(Arena* arena) : ASTNode(arena, NK_DIVIDE) {}
 };
 
 // BINARY OPERATOR NODES
 class OrNode : public ASTNode {
-	public: OrNode() : ASTNode("Or") {}
+	public: OrNode(Arena* arena) : ASTNode(arena, NK_OR) {}
 };
 class AndNode : public ASTNode {
-	public: AndNode() : ASTNode("And") {}
+	public: AndNode(Arena* arena) : ASTNode(arena, NK_AND) {}
 };
 
 // RELATIONAL OPERATOR NODES
 class GreaterNode : public ASTNode {
-	public: GreaterNode() : ASTNode("GreaterNode") {}
+	public: GreaterNode(Arena* arena) : ASTNode(arena, NK_GREATER) {}
 };
 class LesserNode : public ASTNode {
-	public: LesserNode() : ASTNode("LesserNode") {}
+	public: LesserNode(Arena* arena) : ASTNode(arena, NK_LESSER) {}
 };
 class EqualsNode : public ASTNode {
-	public: EqualsNode() : ASTNode("EqualsNode") {}
+	public: EqualsNode(Arena* arena) : ASTNode(arena, NK_EQUALS) {}
 };
 class NotEqualsNode : public ASTNode {
-	public: NotEqualsNode() : ASTNode("NotEqualsNode") {}
+	public: NotEqualsNode(Arena* arena) : ASTNode(arena, NK_NOT_EQUALS) {}
 };
 class GreaterEqualsNode : public ASTNode {
-	public: GreaterEqualsNode() : ASTNode("GreaterEqualsNode") {}
+	public: GreaterEqualsNode(Arena* arena) : ASTNode(arena, NK_GREATER_EQUALS) {}
 };
 class LesserEqualsNode : public ASTNode {
-	public: LesserEqualsNode() : ASTNode("LesserEqualsNode") {}
+	public: LesserEqualsNode(Arena* arena) : ASTNode(arena, NK_LESSER_EQUALS) {}
 };
 
 
 
 // ASSINGMENT NODE
 class AssignNode : public ASTNode {
-	public: AssignNode() : ASTNode("Assignment") {}
+	public: AssignNode(Arena* arena) : ASTNode(arena, NK_ASSIGN) {}
 };
 
 
 // VARIABLE DECLARATION NODE
 class VariableDeclNode : public ASTNode {
-	public: VariableDeclNode() : ASTNode("VariableDecl") {}
+	public: VariableDeclNode(Arena* arena) : ASTNode(arena, NK_VARIABLE_DECL) {}
 };
 
 
@@ -197,17 +354,17 @@ class VariableDeclNode : public ASTNode {
 
 // READ/WRITE NODE
 class ReadNode : public ASTNode {
-	public: ReadNode() : ASTNode("Read") {}
+	public: ReadNode(Arena* arena) : ASTNode(arena, NK_READ) {}
 };
 class WriteNode : public ASTNode {
-	public: WriteNode() : ASTNode("Write") {}
+	public: WriteNode(Arena* arena) : ASTNode(arena, NK_WRITE) {}
 };
 
 
 
 // HALT NODE
 class HaltNode : public ASTNode {
-	public: HaltNode() : ASTNode("Halt") {}
+	public: HaltNode(Arena* arena) : ASTNode(arena, NK_HALT) {}
 };
 
 
@@ -215,34 +372,85 @@ class HaltNode : public ASTNode {
 
 // STATEMENT NODE
 class StatementNode : public ASTNode {
-	public: StatementNode() : ASTNode("Statement") {}
+	public: StatementNode(Arena* arena) : ASTNode(arena, NK_STATEMENT) {}
 };
 
 
 // IF NODE
 class IfNode : public ASTNode {
-	public: IfNode() : ASTNode("If") {}
+	public: IfNode(Arena* arena) : ASTNode(arena, NK_IF) {}
 };
 class ThenNode : public ASTNode {
-	public: ThenNode() : ASTNode("Then") {}
+	public: ThenNode(Arena* arena) : ASTNode(arena, NK_THEN) {}
 };
 class ElseNode : public ASTNode {
-	public: ElseNode() : ASTNode("Else") {}
+	public: ElseNode(Arena* arena) : ASTNode(arena, NK_ELSE) {}
 };
 
 // WHILE NODE
 class WhileNode : public ASTNode {
-	public: WhileNode() : ASTNode("While") {}
+	public: WhileNode(Arena* arena) : ASTNode(arena, NK_WHILE) {}
 };
 
 // BLOCK NODE
 class BlockNode : public ASTNode {
-	public: BlockNode() : ASTNode("Block") {}
+	public: BlockNode(Arena* arena) : ASTNode(arena, NK_BLOCK) {}
 };
 
 // SXL NODE
 class SXLNode : public ASTNode {
-	public: SXLNode() : ASTNode("SXL") {}
-};
+	public: SXLNode(Arena* arena) : ASTNode(arena, NK_SXL) {}
+};
+
+
+/**
+ * Lists every node class, with its kind, as X(Name, Class, Kind), for code that must
+ * handle every class (see ast-visitor.h).
+ */
+#define AST_NODE_CLASSES(X) \
+	X(Type, TypeNode, NK_TYPE) \
+	X(Identifier, IdentifierNode, NK_IDENTIFIER) \
+	X(FuncDecl, FuncDeclNode, NK_FUNC_DECL) \
+	X(Param, ParamNode, NK_PARAM) \
+	X(Params, ParamsNode, NK_PARAMS) \
+	X(Expr, ExprNode, NK_EXPRESSION) \
+	X(TypeCast, TypeCastNode, NK_TYPE_CAST) \
+	X(IntegerLiteral, IntegerLiteralNode, NK_INTEGER_LITERAL) \
+	X(RealLiteral, RealLiteralNode, NK_REAL_LITERAL) \
+	X(CharLiteral, CharLiteralNode, NK_CHAR_LITERAL) \
+	X(StringLiteral, StringLiteralNode, NK_STRING_LITERAL) \
+	X(BooleanLiteral, BooleanLiteralNode, NK_BOOLEAN_LITERAL) \
+	X(UnitLiteral, UnitLiteralNode, NK_UNIT_LITERAL) \
+	X(FuncCall, FuncCallNode, NK_FUNC_CALL) \
+	X(FuncParams, FuncParamsNode, NK_FUNC_PARAMS) \
+	X(Unary, UnaryNode, NK_UNARY) \
+	X(UnaryOp, UnaryOpNode, NK_UNARY_OP) \
+	X(Plus, PlusNode, NK_PLUS) \
+	X(Minus, MinusNode, NK_MINUS) \
+	X(Multiply, MultiplyNode, NK_MULTIPLY) \
+	X(Divide, DivideNode, NK_DIVIDE) \
+	X(Or, OrNode, NK_OR) \
+	X(And, AndNode, NK_AND) \
+	X(Greater, GreaterNode, NK_GREATER) \
+	X(Lesser, LesserNode, NK_LESSER) \
+	X(Equals, EqualsNode, NK_EQUALS) \
+	X(NotEquals, NotEqualsNode, NK_NOT_EQUALS) \
+	X(GreaterEquals, GreaterEqualsNode, NK_GREATER_EQUALS) \
+	X(LesserEquals, LesserEqualsNode, NK_LESSER_EQUALS) \
+	X(Assign, AssignNode, NK_ASSIGN) \
+	X(VariableDecl, VariableDeclNode, NK_VARIABLE_DECL) \
+	X(Read, ReadNode, NK_READ) \
+	X(Write, WriteNode, NK_WRITE) \
+	X(Halt, HaltNode, NK_HALT) \
+	X(Statement, StatementNode, NK_STATEMENT) \
+	X(If, IfNode, NK_IF) \
+	X(Then, ThenNode, NK_THEN) \
+	X(Else, ElseNode, NK_ELSE) \
+	X(While, WhileNode, NK_WHILE) \
+	X(Block, BlockNode, NK_BLOCK) \
+	X(SXL, SXLNode, NK_SXL)
+
+// ASTNode::toString() is written by an ASTWriter
+#include "ast-writer.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include "lexer.h"
+#include "parser.h"
+
+using namespace std;
+
+/**
+ * Expression parsing benchmark.
+ * Times the parsing of statements with long operator chains, such as generated code
+ * has, for chains of increasing length, with each way of parsing expressions:
+ * recursive descent, with backtracking or predictive, and precedence climbing, with
+ * backtracking or predictive. Recursive descent only parses one adding operator in a
+ * row, so that it fails on chains of them, shown as "-".
+ *
+ *	expr-bench [terms] [statements] [runs]
+ */
+
+// The operators of each kind of chain
+static const char* const MULTIPLYING[] = { "*", "/", "and", "*" };
+static const char* const ADDING[] = { "+", "-", "or", "+" };
+
+/**
+ * Returns a source of statements, each setting a variable to a chain of the given
+ * number of terms, joined by the given operators in turn.
+ */
+static string generate(const char* const* ops, size_t terms, size_t statements) {
+	string out;
+	for ( size_t s = 0; s < statements; s++ ) {
+		out += "set x <- a0";
+		for ( size_t i = 1; i < terms; i++ ) {
+			out += ' ';
+			out += ops[ ( i + s ) % 4 ];
+			out += " a" + to_string(i % 100);
+		}
+		out += ";\n";
+	}
+	return out;
+}
+
+static double seconds() {
+	return chrono::duration<double>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/**
+ * Returns the best time of the given number of runs, or 0 if parsing failed.
+ */
+static double run(SourceBuffer* source, bool predictive, bool climbing, int runs) {
+	Lexer lexer(source);
+	lexer.setQuiet(true);
+	lexer.generateTokens();
+	double best = 0;
+	for ( int i = 0; i < runs; i++ ) {
+		lexer.setPosition(0);
+		Parser parser(&lexer);
+		parser.setPredictive(predictive);
+		parser.setPrecedenceClimbing(climbing);
+		double start = seconds();
+		try {
+			parser.parseSXL();
+		} catch( ParseException &e ) {
+			return 0;
+		}
+		double time = seconds() - start;
+		if ( i == 0 || time < best ) {
+			best = time;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	size_t maxTerms = ( argc > 1 )? atoi(argv[1]) : 4000;
+	size_t statements = ( argc > 2 )? atoi(argv[2]) : 20;
+	int runs = ( argc > 3 )? atoi(argv[3]) : 3;
+
+	printf("%zu statements, best of %d runs, in ms\n", statements, runs);
+	printf("%-6s %8s %12s %12s %12s %12s\n", "chain", "terms", "recursive", "predictive", "climbing", "pred+climb");
+	const char* const* chains[] = { MULTIPLYING, ADDING };
+	const char* names[] = { "a * b", "a + b" };
+	for ( int chain = 0; chain < 2; chain++ ) {
+		for ( size_t terms = 250; terms <= maxTerms; terms *= 2 ) {
+			SourceBuffer source( generate(chains[chain], terms, statements) );
+			printf("%-6s %8zu", names[chain], terms);
+			double time = 0;
+			for ( int mode = 0; mode < 4; mode++ ) {
+				time = run(&source, mode & 1, mode & 2, runs);
+				if ( time == 0 ) {
+					printf(" %12s", "-");
+				} else {
+					printf(" %12.2f", time * 1000);
+				}
+			}
+			printf("\n");
+			// Predictive precedence climbing parses every chain
+			if ( time == 0 ) {
+				cerr << "Parsing failed" << endl;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
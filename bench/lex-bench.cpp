@@ -0,0 +1,179 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include "lexer.h"
+#include "parallel-lexer.h"
+
+using namespace std;
+
+/**
+ * Lexer throughput benchmark.
+ * Times generateTokens() over a large generated source, or a given file, and reports
+ * the best rate in MB/s of several runs, for each way of lexing: all tokens ahead of
+ * parsing by the hand-written scanner, by the DFA tables, or by threads, and tokens
+ * pulled one at a time in streaming mode.
+ *
+ *	lex-bench [megabytes] [runs]
+ *	lex-bench --file <path> [runs]
+ */
+
+// Deterministic pseudo-random numbers, so that every run lexes the same source
+static uint32_t seed = 12345;
+
+static uint32_t rnd(uint32_t n) {
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 16 ) % n;
+}
+
+static const char* pick(const char* const* list, size_t size) {
+	return list[ rnd(size) ];
+}
+
+#define PICK(list) pick(list, sizeof(list) / sizeof(*list))
+
+static const char* const IDS[] = { "x", "y", "counter", "_tmp", "value2", "alpha_beta", "i", "n" };
+static const char* const TYPES[] = { "int", "real", "bool", "char", "string" };
+static const char* const OPS[] = { "+", "-", "*", "/", "and", "or", "<", "==", "!=" };
+static const char* const STRINGS[] = { "\"hello world\"", "\"with \\\"escaped\\\" quotes\"", "\"tab\\tend\"", "\"\"" };
+
+static void literal(string& out) {
+	char buffer[32];
+	switch ( rnd(6) ) {
+		case 0:	snprintf(buffer, sizeof(buffer), "%u", rnd(100000)); break;
+		case 1:	snprintf(buffer, sizeof(buffer), "%u.%u", rnd(1000), rnd(1000)); break;
+		case 2:	snprintf(buffer, sizeof(buffer), "%s", rnd(2)? "true" : "false"); break;
+		case 3:	snprintf(buffer, sizeof(buffer), "'%c'", 'a' + rnd(26)); break;
+		case 4:	snprintf(buffer, sizeof(buffer), "%s", PICK(STRINGS)); break;
+		default:	snprintf(buffer, sizeof(buffer), "%s", PICK(IDS)); break;
+	}
+	out += buffer;
+}
+
+static void expression(string& out) {
+	literal(out);
+	for ( uint32_t i = rnd(4); i > 0; i-- ) {
+		out += ' ';
+		out += PICK(OPS);
+		out += ' ';
+		literal(out);
+	}
+}
+
+static void statement(string& out, int depth) {
+	string indent(depth, '\t');
+	out += indent;
+	switch ( depth < 3? rnd(7) : rnd(4) ) {
+		case 0:
+			out += "let "; out += PICK(IDS); out += " : "; out += PICK(TYPES); out += " = ";
+			expression(out);
+			out += ";\n";
+			break;
+		case 1:
+			out += "set "; out += PICK(IDS); out += " <- ";
+			expression(out);
+			out += ";\n";
+			break;
+		case 2:
+			out += "write "; out += PICK(IDS); out += ";\n";
+			break;
+		case 3:
+			out += "// a line comment\n";
+			break;
+		default:
+			out += rnd(2)? "while ( " : "if ( ";
+			expression(out);
+			out += " ) {\n";
+			for ( uint32_t i = 1 + rnd(4); i > 0; i-- ) {
+				statement(out, depth + 1);
+			}
+			out += indent + "}\n";
+			break;
+	}
+}
+
+/**
+ * Returns a source of at least the given size, of functions like those of real programs.
+ */
+static string generate(size_t size) {
+	string out;
+	out.reserve(size + 4096);
+	for ( int k = 0; out.size() < size; k++ ) {
+		out += "function f" + to_string(k) + " ( p : int ) : int {\n";
+		for ( uint32_t i = 1 + rnd(6); i > 0; i-- ) {
+			statement(out, 1);
+		}
+		out += "}\n";
+	}
+	return out;
+}
+
+static double seconds() {
+	return chrono::duration<double>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+enum Mode { SERIAL, TABLE, PARALLEL, STREAMING };
+
+/**
+ * Returns the best time of the given number of runs, and the number of tokens.
+ */
+static double run(SourceBuffer* source, Mode mode, int runs, size_t* tokens) {
+	double best = 0;
+	for ( int i = 0; i < runs; i++ ) {
+		Lexer lexer(source);
+		lexer.setQuiet(true);
+		lexer.setTableDriven( mode == TABLE );
+		lexer.setStreaming( mode == STREAMING );
+		size_t n = 0;
+		double start = seconds();
+		if ( mode == PARALLEL ) {
+			ParallelLexer::generateTokens(&lexer);
+		} else if ( mode == STREAMING ) {
+			// Pulled one at a time, as the parser does, into the bounded window
+			for ( Token* tk = lexer.nextToken(); !tk->isNullToken(); tk = lexer.nextToken() ) {
+				n++;
+			}
+		} else {
+			lexer.generateTokens();
+		}
+		double time = seconds() - start;
+		if ( lexer.hasFailed() ) {
+			cerr << "Lexing failed" << endl;
+			exit(1);
+		}
+		*tokens = ( mode == STREAMING )? n : lexer.getTokens().size();
+		if ( i == 0 || time < best ) {
+			best = time;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	SourceBuffer* source;
+	int runs = 5;
+	if ( argc > 2 && string(argv[1]) == "--file" ) {
+		source = SourceBuffer::fromFile(argv[2]);
+		if ( argc > 3 ) {
+			runs = atoi(argv[3]);
+		}
+	} else {
+		size_t megabytes = ( argc > 1 )? atoi(argv[1]) : 32;
+		if ( argc > 2 ) {
+			runs = atoi(argv[2]);
+		}
+		source = new SourceBuffer( generate(megabytes << 20) );
+	}
+
+	double mb = source->size() / 1048576.0;
+	printf("%.1f MB, best of %d runs\n", mb, runs);
+	const char* names[] = { "serial", "table-driven", "parallel", "streaming" };
+	for ( int mode = SERIAL; mode <= STREAMING; mode++ ) {
+		size_t tokens = 0;
+		double time = run(source, (Mode) mode, runs, &tokens);
+		printf("%-14s %8.1f MB/s %8.1f Mtokens/s  %zu tokens\n", names[mode], mb / time, tokens / time / 1e6, tokens);
+	}
+
+	delete source;
+	return 0;
+}
@@ -0,0 +1,449 @@
+#ifndef __DFA_LEXER_H__
+#define __DFA_LEXER_H__
+
+#include <cstddef>
+#include "tokentype.h"
+
+using namespace std;
+
+/**
+ * Character classes of the DFA.
+ * Characters that are handled the same way in every state share a class.
+ */
+enum DfaClass : unsigned char {
+	C_SPACE,		// ' '
+	C_TAB,			// '\t'
+	C_NL,			// '\n'
+	C_LETTER,		// Letters other than 'e' and 'E', and '_'
+	C_E,			// 'e' and 'E', which start the exponent of a real
+	C_DIGIT,
+	C_DOT,
+	C_DQUOTE,
+	C_SQUOTE,
+	C_BSLASH,
+	C_SLASH,
+	C_STAR,
+	C_LT,
+	C_GT,
+	C_EQ,
+	C_BANG,
+	C_PLUS,
+	C_MINUS,
+	C_HASH,
+	C_COLON,
+	C_SEMI,
+	C_COMMA,
+	C_LPAREN,
+	C_RPAREN,
+	C_LBRACE,
+	C_RBRACE,
+	C_PRINT,		// Any other printable character
+	C_OTHER,		// Any other character
+	C_END,			// The NUL characters read past the end of the source
+	// Classes per state in the transition table
+	C_COUNT = 32
+};
+
+/**
+ * States of the DFA.
+ */
+enum DfaState : unsigned char {
+	S_START,		// Between tokens
+	S_SLASH,		// After '/'
+	S_LINE_COMMENT,	// In a "//" comment
+	S_COMMENT,		// In a block comment
+	S_COMMENT_STAR,	// In a block comment, after a '*' (including the opening one)
+	S_STRING,		// In a string literal
+	S_STRING_ESC,	// In a string literal, after a '\\'
+	S_CHAR,			// After the opening '\''
+	S_CHAR_ESC,		// After "'\\"
+	S_CHAR_END,		// Before the closing '\''
+	S_IDENT,
+	S_INT,
+	S_FRAC,			// After the '.' of a real
+	S_EXP,			// After an 'e' or 'E' following the fraction of a real
+	S_EXP_DIGITS,	// After the exponent sign of a real
+	S_LT,
+	S_GT,
+	S_EQ,
+	S_BANG,
+	S_COUNT
+};
+
+/**
+ * Actions of the DFA, taken when it stops on the character at position p.
+ */
+enum DfaAction : unsigned char {
+	// Move on to the next state, and to the next character
+	A_NONE,
+	// Skip the characters so far, including the one at p (whitespace, comments)
+	A_SKIP,
+	// Skip the characters so far, excluding the one at p
+	A_SKIP_BEFORE,
+	// Token ending after p
+	A_TOKEN,
+	// Token ending at p
+	A_TOKEN_BEFORE,
+	// Token ending at p, with the character at p read ahead
+	A_TOKEN_READ_AHEAD,
+	// Token ending at p-1, with the character at p-1 read ahead
+	A_TOKEN_BACK,
+	// End of input
+	A_EOF,
+	// Unrecognized character at p, or at p-1
+	A_UNRECOGNIZED,
+	A_UNRECOGNIZED_BEFORE,
+	// Malformed character literals
+	A_EXPECTED_PRINTABLE,
+	A_EXPECTED_QUOTE
+};
+
+
+/**
+ * An entry of the transition table: the next state, or the action to take.
+ */
+struct DfaEntry {
+	unsigned char next;
+	unsigned char action;
+	TokenType type;
+	TokenSubtype subtype;
+
+	constexpr DfaEntry(unsigned char next, unsigned char action, TokenType type, TokenSubtype subtype)
+		: next(next), action(action), type(type), subtype(subtype) {}
+};
+
+constexpr DfaEntry dfaGo(DfaState state) {
+	return DfaEntry(state, A_NONE, TK_NONE, ST_NONE);
+}
+constexpr DfaEntry dfaDo(DfaAction action, TokenType type = TK_NONE, TokenSubtype subtype = ST_NONE) {
+	return DfaEntry(S_START, action, type, subtype);
+}
+
+
+/**
+ * Returns the class of the given character.
+ */
+constexpr DfaClass dfaCharClass(int c) {
+	return
+		c == ' ' ? C_SPACE :
+		c == '\t' ? C_TAB :
+		c == '\n' ? C_NL :
+		( c == 'e' || c == 'E' ) ? C_E :
+		( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || c == '_' ) ? C_LETTER :
+		( c >= '0' && c <= '9' ) ? C_DIGIT :
+		c == '.' ? C_DOT :
+		c == '"' ? C_DQUOTE :
+		c == '\'' ? C_SQUOTE :
+		c == '\\' ? C_BSLASH :
+		c == '/' ? C_SLASH :
+		c == '*' ? C_STAR :
+		c == '<' ? C_LT :
+		c == '>' ? C_GT :
+		c == '=' ? C_EQ :
+		c == '!' ? C_BANG :
+		c == '+' ? C_PLUS :
+		c == '-' ? C_MINUS :
+		c == '#' ? C_HASH :
+		c == ':' ? C_COLON :
+		c == ';' ? C_SEMI :
+		c == ',' ? C_COMMA :
+		c == '(' ? C_LPAREN :
+		c == ')' ? C_RPAREN :
+		c == '{' ? C_LBRACE :
+		c == '}' ? C_RBRACE :
+		( c >= 0x20 && c <= 0x7E ) ? C_PRINT :
+		C_OTHER;
+}
+
+/**
+ * Returns true if the characters of the class are printable.
+ */
+constexpr bool dfaPrintable(unsigned c) {
+	return c != C_TAB && c != C_NL && c != C_OTHER && c != C_END;
+}
+
+/**
+ * Transitions of each state.
+ * These follow Lexer::scanToken(), including the characters it reads ahead.
+ */
+constexpr DfaEntry dfaStart(unsigned c) {
+	return
+		( c == C_SPACE || c == C_TAB || c == C_NL ) ? dfaDo(A_SKIP) :
+		c == C_SLASH ? dfaGo(S_SLASH) :
+		c == C_DQUOTE ? dfaGo(S_STRING) :
+		c == C_SQUOTE ? dfaGo(S_CHAR) :
+		( c == C_LETTER || c == C_E ) ? dfaGo(S_IDENT) :
+		c == C_DIGIT ? dfaGo(S_INT) :
+		c == C_LT ? dfaGo(S_LT) :
+		c == C_GT ? dfaGo(S_GT) :
+		c == C_EQ ? dfaGo(S_EQ) :
+		c == C_BANG ? dfaGo(S_BANG) :
+		c == C_HASH ? dfaDo(A_TOKEN, TK_UNIT) :
+		c == C_COLON ? dfaDo(A_TOKEN, TK_COLON) :
+		c == C_SEMI ? dfaDo(A_TOKEN, TK_SEMICOLON) :
+		c == C_COMMA ? dfaDo(A_TOKEN, TK_COMMA) :
+		c == C_LPAREN ? dfaDo(A_TOKEN, TK_OPEN_PAREN) :
+		c == C_RPAREN ? dfaDo(A_TOKEN, TK_CLOSE_PAREN) :
+		c == C_LBRACE ? dfaDo(A_TOKEN, TK_OPEN_BLOCK) :
+		c == C_RBRACE ? dfaDo(A_TOKEN, TK_CLOSE_BLOCK) :
+		c == C_PLUS ? dfaDo(A_TOKEN, TK_ADD_OP, OP_PLUS) :
+		c == C_MINUS ? dfaDo(A_TOKEN, TK_ADD_OP, OP_MINUS) :
+		c == C_STAR ? dfaDo(A_TOKEN, TK_MULT_OP, OP_MULT) :
+		c == C_END ? dfaDo(A_EOF, TK_EOF) :
+		dfaDo(A_UNRECOGNIZED);
+}
+constexpr DfaEntry dfaSlash(unsigned c) {
+	return
+		c == C_SLASH ? dfaGo(S_LINE_COMMENT) :
+		c == C_STAR ? dfaGo(S_COMMENT_STAR) :
+		dfaDo(A_TOKEN_BEFORE, TK_MULT_OP, OP_DIV);
+}
+constexpr DfaEntry dfaLineComment(unsigned c) {
+	return
+		c == C_NL ? dfaDo(A_SKIP) :
+		c == C_END ? dfaDo(A_SKIP_BEFORE) :
+		dfaGo(S_LINE_COMMENT);
+}
+constexpr DfaEntry dfaComment(unsigned c) {
+	// An unterminated comment reads one NUL past the end
+	return
+		c == C_STAR ? dfaGo(S_COMMENT_STAR) :
+		c == C_END ? dfaDo(A_SKIP) :
+		dfaGo(S_COMMENT);
+}
+constexpr DfaEntry dfaCommentStar(unsigned c) {
+	return
+		( c == C_SLASH || c == C_END ) ? dfaDo(A_SKIP) :
+		c == C_STAR ? dfaGo(S_COMMENT_STAR) :
+		dfaGo(S_COMMENT);
+}
+constexpr DfaEntry dfaString(unsigned c) {
+	return
+		c == C_DQUOTE ? dfaDo(A_TOKEN, TK_STRING) :
+		c == C_BSLASH ? dfaGo(S_STRING_ESC) :
+		dfaPrintable(c) ? dfaGo(S_STRING) :
+		dfaDo(A_UNRECOGNIZED);
+}
+constexpr DfaEntry dfaStringEsc(unsigned c) {
+	// "\\\"" does not end the literal, and neither does "\\\\\""
+	return
+		c == C_BSLASH ? dfaGo(S_STRING_ESC) :
+		dfaPrintable(c) ? dfaGo(S_STRING) :
+		dfaDo(A_UNRECOGNIZED);
+}
+constexpr DfaEntry dfaChar(unsigned c) {
+	return
+		c == C_BSLASH ? dfaGo(S_CHAR_ESC) :
+		dfaPrintable(c) ? dfaGo(S_CHAR_END) :
+		dfaDo(A_EXPECTED_PRINTABLE);
+}
+constexpr DfaEntry dfaCharEnd(unsigned c) {
+	return
+		c == C_SQUOTE ? dfaDo(A_TOKEN, TK_CHAR) :
+		dfaDo(A_EXPECTED_QUOTE);
+}
+constexpr DfaEntry dfaIdent(unsigned c) {
+	return
+		( c == C_LETTER || c == C_E || c == C_DIGIT ) ? dfaGo(S_IDENT) :
+		dfaDo(A_TOKEN_READ_AHEAD, TK_IDENTIFIER);
+}
+constexpr DfaEntry dfaInt(unsigned c) {
+	return
+		c == C_DIGIT ? dfaGo(S_INT) :
+		c == C_DOT ? dfaGo(S_FRAC) :
+		dfaDo(A_TOKEN_READ_AHEAD, TK_INTEGER);
+}
+constexpr DfaEntry dfaFrac(unsigned c) {
+	return
+		c == C_DIGIT ? dfaGo(S_FRAC) :
+		c == C_E ? dfaGo(S_EXP) :
+		dfaDo(A_TOKEN_READ_AHEAD, TK_REAL);
+}
+constexpr DfaEntry dfaExp(unsigned c) {
+	// Without a sign, the 'e' is not part of the real
+	return
+		( c == C_PLUS || c == C_MINUS ) ? dfaGo(S_EXP_DIGITS) :
+		dfaDo(A_TOKEN_BACK, TK_REAL);
+}
+constexpr DfaEntry dfaExpDigits(unsigned c) {
+	return
+		c == C_DIGIT ? dfaGo(S_EXP_DIGITS) :
+		dfaDo(A_TOKEN_READ_AHEAD, TK_REAL);
+}
+constexpr DfaEntry dfaLt(unsigned c) {
+	return
+		c == C_MINUS ? dfaDo(A_TOKEN, TK_ASSIGN_OP) :
+		c == C_EQ ? dfaDo(A_TOKEN, TK_REL_OP, OP_LE) :
+		dfaDo(A_TOKEN_BEFORE, TK_REL_OP, OP_LT);
+}
+constexpr DfaEntry dfaGt(unsigned c) {
+	return
+		c == C_EQ ? dfaDo(A_TOKEN, TK_REL_OP, OP_GE) :
+		dfaDo(A_TOKEN_BEFORE, TK_REL_OP, OP_GT);
+}
+constexpr DfaEntry dfaEq(unsigned c) {
+	return
+		c == C_EQ ? dfaDo(A_TOKEN, TK_REL_OP, OP_EQ) :
+		dfaDo(A_TOKEN_BEFORE, TK_EQUALS_OP);
+}
+constexpr DfaEntry dfaBang(unsigned c) {
+	return
+		c == C_EQ ? dfaDo(A_TOKEN, TK_REL_OP, OP_NE) :
+		dfaDo(A_UNRECOGNIZED_BEFORE);
+}
+
+constexpr DfaEntry dfaEntry(unsigned s, unsigned c) {
+	return
+		s == S_START ? dfaStart(c) :
+		s == S_SLASH ? dfaSlash(c) :
+		s == S_LINE_COMMENT ? dfaLineComment(c) :
+		s == S_COMMENT ? dfaComment(c) :
+		s == S_COMMENT_STAR ? dfaCommentStar(c) :
+		s == S_STRING ? dfaString(c) :
+		s == S_STRING_ESC ? dfaStringEsc(c) :
+		s == S_CHAR ? dfaChar(c) :
+		s == S_CHAR_ESC ? dfaGo(S_CHAR_END) :
+		s == S_CHAR_END ? dfaCharEnd(c) :
+		s == S_IDENT ? dfaIdent(c) :
+		s == S_INT ? dfaInt(c) :
+		s == S_FRAC ? dfaFrac(c) :
+		s == S_EXP ? dfaExp(c) :
+		s == S_EXP_DIGITS ? dfaExpDigits(c) :
+		s == S_LT ? dfaLt(c) :
+		s == S_GT ? dfaGt(c) :
+		s == S_EQ ? dfaEq(c) :
+		dfaBang(c);
+}
+
+
+/**
+ * Compile-time index sequences (std::index_sequence is C++14), built by halves to
+ * keep the template recursion shallow.
+ */
+template <size_t... I> struct DfaIndices {};
+
+template <class A, class B> struct DfaConcat;
+template <size_t... I, size_t... J>
+struct DfaConcat< DfaIndices<I...>, DfaIndices<J...> > {
+	typedef DfaIndices<I..., ( sizeof...(I) + J )...> type;
+};
+
+template <size_t N> struct DfaMakeIndices {
+	typedef typename DfaConcat< typename DfaMakeIndices<N / 2>::type, typename DfaMakeIndices<N - N / 2>::type >::type type;
+};
+template <> struct DfaMakeIndices<0> { typedef DfaIndices<> type; };
+template <> struct DfaMakeIndices<1> { typedef DfaIndices<0> type; };
+
+/**
+ * The tables of the DFA: the class of every character, and the transitions of every
+ * state, indexed by state * C_COUNT + class.
+ */
+struct DfaTables {
+	unsigned char classes[256];
+	DfaEntry transitions[S_COUNT * C_COUNT];
+};
+
+template <size_t... I, size_t... J>
+constexpr DfaTables dfaMakeTables(DfaIndices<I...>, DfaIndices<J...>) {
+	return DfaTables{ { dfaCharClass(I)... }, { dfaEntry(J / C_COUNT, J % C_COUNT)... } };
+}
+
+
+/**
+ * The result of DfaLexer::scan().
+ * Positions may be past the end of the source, as NUL characters are read there.
+ */
+struct DfaResult {
+	// What the DFA stopped on
+	DfaAction action;
+	// Token type and subtype
+	TokenType type;
+	TokenSubtype subtype;
+	// Range of the token image
+	size_t start;
+	size_t end;
+	// Number of characters read, including the one read ahead, if any
+	size_t read;
+	// The offending character, on errors
+	char ch;
+};
+
+
+/**
+ * The DfaLexer class.
+ * A table-driven alternative to the character tests of Lexer::scanToken(): a single
+ * loop looks up the class of each character and the transition of the current
+ * state, until the transition has an action. Both tables are generated at compile
+ * time from the constexpr functions above.
+ *
+ * The DFA only finds the token range and type. The Lexer classifies keywords, and
+ * reports errors (see Lexer::setTableDriven()).
+ */
+class DfaLexer {
+	public:
+		static const DfaTables& tables() {
+			static constexpr DfaTables t = dfaMakeTables( DfaMakeIndices<256>::type(), DfaMakeIndices<S_COUNT * C_COUNT>::type() );
+			return t;
+		}
+
+		/**
+		 * Scans the next token of the source, starting at position p.
+		 * Whitespace and comments before the token are skipped.
+		 */
+		static DfaResult scan(const char* data, size_t size, size_t p) {
+			const DfaTables& t = DfaLexer::tables();
+			const DfaEntry* e;
+			size_t start = p;
+			unsigned state = S_START;
+			while ( true ) {
+				// Run the DFA up to the first action
+				unsigned c = ( p < size )? t.classes[(unsigned char) data[p]] : (unsigned char) C_END;
+				e = &t.transitions[ state * C_COUNT + c ];
+				if ( e->action == A_NONE ) {
+					state = e->next;
+					p++;
+					continue;
+				}
+				// Skip whitespace and comments, and start over
+				if ( e->action == A_SKIP || e->action == A_SKIP_BEFORE ) {
+					p += ( e->action == A_SKIP );
+					start = p;
+					state = S_START;
+					continue;
+				}
+				break;
+			}
+
+			DfaResult r;
+			r.action = (DfaAction) e->action;
+			r.type = e->type;
+			r.subtype = e->subtype;
+			r.start = start;
+			r.ch = '\0';
+			switch ( e->action ) {
+				case A_TOKEN_BEFORE:
+				case A_UNRECOGNIZED_BEFORE:
+					r.end = p;
+					r.read = p;
+					r.ch = data[p - 1];
+					break;
+				case A_TOKEN_READ_AHEAD:
+					r.end = p;
+					r.read = p + 1;
+					break;
+				case A_TOKEN_BACK:
+					r.end = p - 1;
+					r.read = p;
+					break;
+				default:
+					r.end = p + 1;
+					r.read = p + 1;
+					r.ch = ( p < size )? data[p] : '\0';
+					break;
+			}
+			return r;
+		}
+};
+
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef __DIAGNOSTIC_H__
+#define __DIAGNOSTIC_H__
+
+#include <string>
+#include <cstdint>
+#include "token.h"
+#include "source-buffer.h"
+
+using namespace std;
+
+/**
+ * The kinds of syntax errors.
+ */
+enum DiagnosticCode : unsigned char {
+	// A token other than the expected ones
+	DG_EXPECTED,
+	// A type name that is not a type keyword
+	DG_UNKNOWN_TYPE,
+	// An operator token that cannot be a unary operator
+	DG_INVALID_UNARY_OPERATOR,
+	// A halt statement with an exit code other than the expected ones
+	DG_INVALID_EXIT_CODE,
+	// An operator token whose subtype does not match its type
+	DG_INVALID_OPERATOR
+};
+
+/**
+ * What a parser expected to find, as a set of bits.
+ */
+enum Expected : uint32_t {
+	EX_IDENTIFIER			= 1 << 0,
+	EX_TYPE					= 1 << 1,
+	EX_LITERAL				= 1 << 2,
+	EX_INTEGER				= 1 << 3,
+	EX_COLON				= 1 << 4,
+	EX_SEMICOLON			= 1 << 5,
+	EX_OPEN_PAREN			= 1 << 6,
+	EX_CLOSE_PAREN			= 1 << 7,
+	EX_OPEN_BRACE			= 1 << 8,
+	EX_CLOSE_BRACE			= 1 << 9,
+	EX_ASSIGN_OP			= 1 << 10,
+	EX_EQUALS				= 1 << 11,
+	EX_RELATIONAL_OP		= 1 << 12,
+	EX_ADDITIVE_OP			= 1 << 13,
+	EX_MULTIPLICATIVE_OP	= 1 << 14,
+	EX_NOT					= 1 << 15,
+	EX_FUNCTION				= 1 << 16,
+	EX_SET					= 1 << 17,
+	EX_LET					= 1 << 18,
+	EX_IF					= 1 << 19,
+	EX_WHILE				= 1 << 20,
+	EX_READ					= 1 << 21,
+	EX_WRITE				= 1 << 22,
+	EX_HALT					= 1 << 23,
+	EX_FACTOR				= 1 << 24,
+	EX_STATEMENT			= 1 << 25
+};
+
+/**
+ * Returns the description of a single expected bit, for error messages.
+ */
+inline const char* expectedName(uint32_t bit) {
+	switch( bit ) {
+		case EX_IDENTIFIER:			return "an identifier";
+		case EX_TYPE:				return "a valid type";
+		case EX_LITERAL:			return "a literal";
+		case EX_INTEGER:			return "an integer literal";
+		case EX_COLON:				return "a colon";
+		case EX_SEMICOLON:			return "semicolon ';'";
+		case EX_OPEN_PAREN:			return "an opening parenthesis";
+		case EX_CLOSE_PAREN:		return "a closing parenthesis";
+		case EX_OPEN_BRACE:			return "an opening brace";
+		case EX_CLOSE_BRACE:		return "a closing brace";
+		case EX_ASSIGN_OP:			return "'<-' operator";
+		case EX_EQUALS:				return "'='";
+		case EX_RELATIONAL_OP:		return "a relational operator";
+		case EX_ADDITIVE_OP:		return "an additive operator";
+		case EX_MULTIPLICATIVE_OP:	return "a multiplicative operator";
+		case EX_NOT:				return "a 'not'";
+		case EX_FUNCTION:			return "a 'function' keyword";
+		case EX_SET:				return "'set' keyword";
+		case EX_LET:				return "'let' keyword";
+		case EX_IF:					return "'if' keyword";
+		case EX_WHILE:				return "'while' keyword";
+		case EX_READ:				return "'read' keyword";
+		case EX_WRITE:				return "'write' keyword";
+		case EX_HALT:				return "'halt' keyword";
+		case EX_FACTOR:				return "a valid expression factor";
+		case EX_STATEMENT:			return "a statement";
+		default:					return "?";
+	}
+}
+
+
+/**
+ * The Diagnostic class.
+ * A syntax error, as data: its code, what was expected, and the offending token, with
+ * its index in the token stream. Nothing is formatted until format() is called, so
+ * that errors thrown and caught while backtracking cost no string building.
+ */
+class Diagnostic {
+
+	private:
+		DiagnosticCode code;
+		uint32_t expected;
+		size_t tokenIndex;
+		// A copy of the token, which may be gone from the lexer by the time the
+		// diagnostic is formatted
+		Token token;
+
+	public:
+		Diagnostic(DiagnosticCode code, uint32_t expected, size_t tokenIndex, Token* token) : token(token) {
+			this->code = code;
+			this->expected = expected;
+			this->tokenIndex = tokenIndex;
+		}
+
+		// Returns the kind of error
+		DiagnosticCode getCode() const {
+			return this->code;
+		}
+		// Returns the set of Expected bits
+		uint32_t getExpected() const {
+			return this->expected;
+		}
+		// Returns the index of the offending token
+		size_t getTokenIndex() const {
+			return this->tokenIndex;
+		}
+		// Returns the offending token
+		const Token& getToken() const {
+			return this->token;
+		}
+
+		/**
+		 * Returns the expected set as text: "a, b or c".
+		 */
+		string expectedText() const {
+			string text;
+			uint32_t rest = this->expected;
+			while ( rest != 0 ) {
+				uint32_t bit = rest & -rest;
+				rest &= ~bit;
+				if ( !text.empty() ) {
+					text += ( rest != 0 )? ", " : " or ";
+				}
+				text += expectedName(bit);
+			}
+			return text;
+		}
+
+		/**
+		 * Returns the error message, reading the token image and position from the
+		 * given source.
+		 */
+		string format(SourceBuffer* source) const {
+			Token token = this->token;
+			switch( this->code ) {
+				case DG_EXPECTED:
+					return "Expected " + this->expectedText() + ", found " + token.toString(source);
+				case DG_UNKNOWN_TYPE:
+					return "Unknown type '" + token.getImage( source->data() ) + "', at " + token.getPosition(source);
+				case DG_INVALID_UNARY_OPERATOR:
+					return "Invalid unary operator " + token.toString(source);
+				case DG_INVALID_EXIT_CODE:
+					return "Invalid exit code. Expected " + this->expectedText() + ", found " + token.toString(source);
+				case DG_INVALID_OPERATOR:
+					return "Invalid subtype for " + this->expectedText() + ", found " + token.toString(source) + ". Possible bug in the lexer.";
+			}
+			return "";
+		}
+};
+
+
+#endif
@@ -0,0 +1,535 @@
+#ifndef __FLAT_AST_H__
+#define __FLAT_AST_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include "node-kind.h"
+#include "astnode.h"
+#include "symbol-table.h"
+
+using namespace std;
+
+/**
+ * The ID of no node in a FlatAST.
+ */
+const uint32_t NO_NODE = 0xFFFFFFFF;
+
+/**
+ * The FlatAST class.
+ * An AST stored as a structure of arrays. Nodes are numbered from 0 and each array
+ * holds one field of every node, so that a pass over the tree reads a few contiguous
+ * arrays instead of following pointers.
+ *
+ * The children of a node are a contiguous range of the links array. The text of a
+ * node, if any, the symbol ID of identifiers and the value of literals are kept in
+ * side arrays, indexed by the node's value, since most nodes have none of them.
+ */
+class FlatAST {
+
+	private:
+		// Value of nodes without text
+		static const uint32_t NO_VALUE = 0xFFFFFFFF;
+
+		// Per node
+		vector<NodeKind> kinds;
+		vector<uint32_t> firsts;
+		vector<uint32_t> counts;
+		vector<uint32_t> values;
+		// Children of all nodes
+		vector<uint32_t> links;
+		// Per value: the text, in the chars array (NUL terminated), the symbol ID, and
+		// the bits of the value of a literal (see setLiteral())
+		vector<uint32_t> starts;
+		vector<uint32_t> lengths;
+		vector<uint32_t> symbols;
+		vector<uint64_t> literals;
+		vector<char> chars;
+
+		uint32_t rootNode;
+
+	public:
+		FlatAST() {
+			this->rootNode = NO_NODE;
+		}
+
+		/**
+		 * Adds a node without children, and returns its ID.
+		 */
+		uint32_t add(NodeKind kind) {
+			this->kinds.push_back(kind);
+			this->firsts.push_back(0);
+			this->counts.push_back(0);
+			this->values.push_back(0);
+			this->values.back() = NO_VALUE;
+			return this->kinds.size() - 1;
+		}
+		uint32_t add(NodeKind kind, const char* text, size_t length, uint32_t symbol = NO_SYMBOL) {
+			uint32_t id = this->add(kind);
+			this->values[id] = this->starts.size();
+			this->starts.push_back( this->chars.size() );
+			this->lengths.push_back(length);
+			this->symbols.push_back(symbol);
+			this->literals.push_back(0);
+			this->chars.insert( this->chars.end(), text, text + length );
+			this->chars.push_back('\0');
+			return id;
+		}
+
+		/**
+		 * Makes room for the given number of nodes.
+		 */
+		void reserve(size_t nodes) {
+			this->kinds.reserve(nodes);
+			this->firsts.reserve(nodes);
+			this->counts.reserve(nodes);
+			this->values.reserve(nodes);
+			this->links.reserve(nodes);
+		}
+
+		/**
+		 * Sets the children of a node, which must have none yet.
+		 */
+		void setChildren(uint32_t id, const uint32_t* children, size_t count) {
+			this->firsts[id] = this->links.size();
+			this->counts[id] = count;
+			this->links.insert( this->links.end(), children, children + count );
+		}
+
+		/**
+		 * Adds a copy of the given tree, and returns the ID of its root.
+		 * The tree is walked with an explicit stack, so that deep trees do not use deep
+		 * native stacks.
+		 */
+		uint32_t addTree(ASTNode* root) {
+			vector< pair<ASTNode*, uint32_t> > stack;
+			uint32_t id = this->addNode(root);
+			stack.push_back( make_pair(root, id) );
+			while ( !stack.empty() ) {
+				ASTNode* node = stack.back().first;
+				uint32_t parent = stack.back().second;
+				stack.pop_back();
+
+				// Add the children, and link them to the parent
+				uint32_t count = node->getChildCount();
+				this->firsts[parent] = this->links.size();
+				this->counts[parent] = count;
+				for ( uint32_t i = 0; i < count; i++ ) {
+					this->links.push_back( this->addNode( node->getChild(i) ) );
+				}
+				// Then visit them
+				for ( uint32_t i = count; i > 0; i-- ) {
+					stack.push_back( make_pair( node->getChild(i - 1), this->links[ this->firsts[parent] + i - 1 ] ) );
+				}
+			}
+			return id;
+		}
+
+		/**
+		 * Returns a flat copy of the given tree.
+		 */
+		static FlatAST* fromTree(ASTNode* root) {
+			FlatAST* flat = new FlatAST();
+			flat->setRoot( flat->addTree(root) );
+			return flat;
+		}
+
+		// Returns the ID of the root node
+		uint32_t root() {
+			return this->rootNode;
+		}
+		void setRoot(uint32_t id) {
+			this->rootNode = id;
+		}
+
+		// Returns the number of nodes
+		size_t size() {
+			return this->kinds.size();
+		}
+
+		// Returns the kind of a node
+		NodeKind kind(uint32_t id) {
+			return this->kinds[id];
+		}
+		// Returns the number of children of a node
+		uint32_t childCount(uint32_t id) {
+			return this->counts[id];
+		}
+		// Returns the i-th child of a node
+		uint32_t child(uint32_t id, uint32_t i) {
+			return this->links[ this->firsts[id] + i ];
+		}
+		// Returns the children of a node, as an array of childCount(id) IDs
+		const uint32_t* children(uint32_t id) {
+			return this->links.data() + this->firsts[id];
+		}
+
+		// Checks if a node has text
+		bool hasText(uint32_t id) {
+			return this->values[id] != NO_VALUE;
+		}
+		/**
+		 * Returns the text of a node, or an empty string. The pointer is valid until a
+		 * node is added.
+		 */
+		const char* text(uint32_t id) {
+			uint32_t v = this->values[id];
+			return ( v != NO_VALUE )? this->chars.data() + this->starts[v] : "";
+		}
+		// Returns the length of the text of a node
+		uint32_t textLength(uint32_t id) {
+			uint32_t v = this->values[id];
+			return ( v != NO_VALUE )? this->lengths[v] : 0;
+		}
+		// Returns the symbol ID of an identifier, or NO_SYMBOL
+		uint32_t symbol(uint32_t id) {
+			uint32_t v = this->values[id];
+			return ( v != NO_VALUE )? this->symbols[v] : NO_SYMBOL;
+		}
+
+		/**
+		 * Sets the value of a literal node, which must have text, as with getLiteral().
+		 * The characters of a string with escapes are added to the chars array; those
+		 * of one without are the text between the quotes.
+		 */
+		void setLiteral(uint32_t id, const Literal& value) {
+			uint32_t v = this->values[id];
+			uint64_t bits = 0;
+			switch( this->kinds[id] ) {
+				case NK_REAL_LITERAL:
+					memcpy( &bits, &value.real, sizeof(bits) );
+					break;
+				case NK_CHAR_LITERAL:
+					bits = (unsigned char) value.character;
+					break;
+				case NK_STRING_LITERAL: {
+					uint64_t start = this->starts[v] + 1;
+					if ( value.length + 2 != this->lengths[v] || memcmp( value.text, this->chars.data() + start, value.length ) != 0 ) {
+						start = this->chars.size();
+						this->chars.insert( this->chars.end(), value.text, value.text + value.length );
+						this->chars.push_back('\0');
+					}
+					bits = start | (uint64_t) value.length << 32;
+					break;
+				}
+				default:
+					bits = value.integer;
+					break;
+			}
+			this->literals[v] = bits;
+		}
+		/**
+		 * Returns the value of a literal node, as with getLiteral(). The characters of
+		 * a string are valid until a node is added, and may not be NUL terminated.
+		 */
+		Literal literal(uint32_t id) {
+			Literal value;
+			value.length = 0;
+			uint32_t v = this->values[id];
+			uint64_t bits = ( v != NO_VALUE )? this->literals[v] : 0;
+			switch( this->kinds[id] ) {
+				case NK_REAL_LITERAL:
+					memcpy( &value.real, &bits, sizeof(bits) );
+					break;
+				case NK_CHAR_LITERAL:
+					value.character = (char) bits;
+					break;
+				case NK_STRING_LITERAL:
+					value.text = this->chars.data() + (uint32_t) bits;
+					value.length = bits >> 32;
+					break;
+				default:
+					value.integer = bits;
+					break;
+			}
+			return value;
+		}
+
+		/**
+		 * Returns the number of bytes used by the arrays.
+		 */
+		size_t memoryUsage() {
+			return this->kinds.capacity() * sizeof(NodeKind)
+				+ ( this->firsts.capacity() + this->counts.capacity() + this->values.capacity() + this->links.capacity() ) * sizeof(uint32_t)
+				+ ( this->starts.capacity() + this->lengths.capacity() + this->symbols.capacity() ) * sizeof(uint32_t)
+				+ this->literals.capacity() * sizeof(uint64_t)
+				+ this->chars.capacity();
+		}
+
+		/**
+		 * Looks up the symbol ID of every identifier again, in the given table, or if it
+		 * is NULL, unsets them. The IDs of a tree loaded with fromBytes() are those of
+		 * the table it was built with.
+		 */
+		void internSymbols(SymbolTable* table) {
+			for ( size_t id = 0; id < this->kinds.size(); id++ ) {
+				uint32_t v = this->values[id];
+				if ( this->kinds[id] != NK_IDENTIFIER || v == NO_VALUE ) {
+					continue;
+				}
+				this->symbols[v] = ( table != NULL )? table->intern( this->chars.data() + this->starts[v], this->lengths[v] ) : NO_SYMBOL;
+			}
+		}
+
+		/**
+		 * Appends the tree to the given string, in a binary form that fromBytes() loads
+		 * back: a header with the size of each array and a CRC-32 of the whole form,
+		 * then the arrays themselves, each starting on a 4 byte boundary. Numbers are
+		 * stored in the byte order of the machine, so the form is only meant to be read
+		 * back on the same kind of machine.
+		 */
+		void toBytes(string& out) {
+			size_t begin = out.size();
+			Header header;
+			memcpy( header.magic, BYTES_MAGIC, sizeof(header.magic) );
+			header.version = BYTES_VERSION;
+			header.checksum = 0;
+			header.root = this->rootNode;
+			header.nodes = this->kinds.size();
+			header.links = this->links.size();
+			header.values = this->starts.size();
+			header.chars = this->chars.size();
+
+			out.reserve( out.size() + FlatAST::byteSize(header) );
+			out.append( (const char*) &header, sizeof(header) );
+			FlatAST::append( out, this->kinds.data(), this->kinds.size() );
+			FlatAST::append( out, this->firsts.data(), this->firsts.size() );
+			FlatAST::append( out, this->counts.data(), this->counts.size() );
+			FlatAST::append( out, this->values.data(), this->values.size() );
+			FlatAST::append( out, this->links.data(), this->links.size() );
+			FlatAST::append( out, this->starts.data(), this->starts.size() );
+			FlatAST::append( out, this->lengths.data(), this->lengths.size() );
+			FlatAST::append( out, this->symbols.data(), this->symbols.size() );
+			FlatAST::append( out, this->literals.data(), this->literals.size() );
+			FlatAST::append( out, this->chars.data(), this->chars.size() );
+
+			// The checksum is that of the form with a checksum of 0
+			uint32_t crc = FlatAST::checksum( 0, out.data() + begin, out.size() - begin );
+			memcpy( &out[ begin + offsetof(Header, checksum) ], &crc, sizeof(crc) );
+		}
+
+		/**
+		 * Loads a tree written by toBytes(). The checksum is checked first, then each
+		 * array is copied at once, and checked in a single pass, so that a corrupted
+		 * form cannot make the accessors read out of bounds. Returns NULL if the bytes
+		 * are not a valid tree of this version.
+		 */
+		static FlatAST* fromBytes(const char* data, size_t size) {
+			Header header;
+			if ( size < sizeof(header) ) {
+				return NULL;
+			}
+			memcpy( &header, data, sizeof(header) );
+			if ( memcmp( header.magic, BYTES_MAGIC, sizeof(header.magic) ) != 0 || header.version != BYTES_VERSION ) {
+				return NULL;
+			}
+			if ( size != FlatAST::byteSize(header) ) {
+				return NULL;
+			}
+			uint32_t expected = header.checksum;
+			header.checksum = 0;
+			uint32_t crc = FlatAST::checksum( 0, (const char*) &header, sizeof(header) );
+			crc = FlatAST::checksum( crc, data + sizeof(header), size - sizeof(header) );
+			if ( crc != expected ) {
+				return NULL;
+			}
+
+			FlatAST* flat = new FlatAST();
+			flat->rootNode = header.root;
+			const char* p = data + sizeof(header);
+			p = FlatAST::read( p, flat->kinds, header.nodes );
+			p = FlatAST::read( p, flat->firsts, header.nodes );
+			p = FlatAST::read( p, flat->counts, header.nodes );
+			p = FlatAST::read( p, flat->values, header.nodes );
+			p = FlatAST::read( p, flat->links, header.links );
+			p = FlatAST::read( p, flat->starts, header.values );
+			p = FlatAST::read( p, flat->lengths, header.values );
+			p = FlatAST::read( p, flat->symbols, header.values );
+			p = FlatAST::read( p, flat->literals, header.values );
+			p = FlatAST::read( p, flat->chars, header.chars );
+			if ( !flat->isValid() ) {
+				delete flat;
+				return NULL;
+			}
+			return flat;
+		}
+
+		/**
+		 * Returns the tree as a string, in the same format as ASTNode::toString().
+		 */
+		string toString() {
+			stringstream ss;
+			if ( this->rootNode == NO_NODE ) {
+				return "";
+			}
+			// Stack of (node, next child to print)
+			vector< pair<uint32_t, uint32_t> > stack;
+			stack.push_back( make_pair(this->rootNode, 0) );
+			ss << "<" << nodeKindName( this->kind(this->rootNode) ) << ">";
+			if ( this->textLength(this->rootNode) == 0 ) ss << "\n";
+			else ss << this->text(this->rootNode);
+
+			while ( !stack.empty() ) {
+				uint32_t id = stack.back().first;
+				uint32_t next = stack.back().second;
+				size_t depth = stack.size() - 1;
+
+				if ( next < this->childCount(id) ) {
+					// Open the next child
+					stack.back().second++;
+					uint32_t c = this->child(id, next);
+					ss << string(depth + 1, '\t') << "<" << nodeKindName( this->kind(c) ) << ">";
+					if ( this->textLength(c) == 0 ) ss << "\n";
+					else ss << this->text(c);
+					stack.push_back( make_pair(c, 0) );
+				} else {
+					// Close the node
+					if ( this->textLength(id) == 0 ) ss << string(depth, '\t');
+					ss << "</" << nodeKindName( this->kind(id) ) << ">\n";
+					stack.pop_back();
+				}
+			}
+			return ss.str();
+		}
+
+	private:
+		static constexpr const char* BYTES_MAGIC = "SXLA";
+		// Version of the form written by toBytes()
+		// 2: the values of literals
+		// 3: a checksum
+		static const uint32_t BYTES_VERSION = 3;
+
+		// The start of the form written by toBytes()
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t checksum;
+			uint32_t root;
+			uint32_t nodes;
+			uint32_t links;
+			uint32_t values;
+			uint32_t chars;
+		};
+
+		// Returns the size of an array of n items, padded to 4 bytes
+		template<class T>
+		static size_t arraySize(size_t n) {
+			return ( n * sizeof(T) + 3 ) & ~(size_t) 3;
+		}
+
+		// Returns the size of the form of the tree with the given header
+		static size_t byteSize(const Header& header) {
+			return sizeof(Header)
+				+ FlatAST::arraySize<NodeKind>(header.nodes)
+				+ 3 * FlatAST::arraySize<uint32_t>(header.nodes)
+				+ FlatAST::arraySize<uint32_t>(header.links)
+				+ 3 * FlatAST::arraySize<uint32_t>(header.values)
+				+ FlatAST::arraySize<uint64_t>(header.values)
+				+ FlatAST::arraySize<char>(header.chars);
+		}
+
+		/**
+		 * Returns true if every ID and range in the arrays is in bounds: the root, the
+		 * kinds, the children of each node and the nodes they link to, the value of
+		 * each node, its NUL terminated text, and the characters of strings.
+		 */
+		bool isValid() {
+			size_t nodes = this->kinds.size();
+			size_t values = this->starts.size();
+			if ( this->rootNode != NO_NODE && this->rootNode >= nodes ) {
+				return false;
+			}
+			for ( size_t i = 0; i < nodes; i++ ) {
+				if ( this->kinds[i] >= NK_COUNT ) {
+					return false;
+				}
+				if ( (uint64_t) this->firsts[i] + this->counts[i] > this->links.size() ) {
+					return false;
+				}
+				if ( this->values[i] != NO_VALUE && this->values[i] >= values ) {
+					return false;
+				}
+				if ( this->kinds[i] == NK_STRING_LITERAL && this->values[i] != NO_VALUE ) {
+					uint64_t bits = this->literals[ this->values[i] ];
+					if ( (uint64_t) (uint32_t) bits + ( bits >> 32 ) > this->chars.size() ) {
+						return false;
+					}
+				}
+			}
+			for ( size_t k = 0; k < this->links.size(); k++ ) {
+				if ( this->links[k] >= nodes ) {
+					return false;
+				}
+			}
+			for ( size_t v = 0; v < values; v++ ) {
+				uint64_t end = (uint64_t) this->starts[v] + this->lengths[v];
+				if ( end >= this->chars.size() || this->chars[end] != '\0' ) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * Returns the CRC-32 of the given bytes, continued from the CRC of those before
+		 * them, or 0. A single changed bit, or a run of them shorter than 32, always
+		 * changes it.
+		 */
+		static uint32_t checksum(uint32_t crc, const char* s, size_t length) {
+			struct Table {
+				uint32_t entries[256];
+				Table() {
+					for ( uint32_t i = 0; i < 256; i++ ) {
+						uint32_t c = i;
+						for ( int k = 0; k < 8; k++ ) {
+							c = ( c & 1 )? 0xEDB88320 ^ ( c >> 1 ) : c >> 1;
+						}
+						this->entries[i] = c;
+					}
+				}
+			};
+			static const Table table;
+			crc = ~crc;
+			for ( size_t i = 0; i < length; i++ ) {
+				crc = table.entries[ ( crc ^ (uint8_t) s[i] ) & 0xFF ] ^ ( crc >> 8 );
+			}
+			return ~crc;
+		}
+
+		template<class T>
+		static void append(string& out, const T* items, size_t n) {
+			out.append( (const char*) items, n * sizeof(T) );
+			out.append( FlatAST::arraySize<T>(n) - n * sizeof(T), '\0' );
+		}
+
+		template<class T>
+		static const char* read(const char* p, vector<T>& items, size_t n) {
+			items.resize(n);
+			if ( n > 0 ) {
+				memcpy( items.data(), p, n * sizeof(T) );
+			}
+			return p + FlatAST::arraySize<T>(n);
+		}
+
+		/**
+		 * Adds a copy of a node, without its children.
+		 */
+		uint32_t addNode(ASTNode* node) {
+			if ( node->getTextLength() == 0 ) {
+				return this->add( node->getKind() );
+			}
+			uint32_t symbol = ( node->getKind() == NK_IDENTIFIER )? static_cast<IdentifierNode*>(node)->getSymbol() : NO_SYMBOL;
+			uint32_t id = this->add( node->getKind(), node->getText(), node->getTextLength(), symbol );
+			Literal value;
+			if ( getLiteral(node, &value) ) {
+				this->setLiteral(id, value);
+			}
+			return id;
+		}
+};
+
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef __INCREMENTAL_LEXER_H__
+#define __INCREMENTAL_LEXER_H__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "lexer.h"
+#include "source-buffer.h"
+
+using namespace std;
+
+/**
+ * A change in a token vector: the tokens from first to first + removed were replaced
+ * by inserted new tokens. The tokens after them are the same, shifted.
+ */
+struct TokenEdit {
+	size_t first;
+	size_t removed;
+	size_t inserted;
+};
+
+/**
+ * The IncrementalLexer class.
+ * Keeps the tokens of a source up to date as the source is edited, re-lexing only
+ * the region affected by each edit.
+ *
+ * The state of the lexer right after a token only depends on the token: its end,
+ * and whether it read the next character (see Lexer::resume()). After an edit,
+ * lexing resumes from the last token that did not look at the edited text, and stops
+ * as soon as it produces a token that also was in the old token vector, at the same
+ * place after the edit, with the same type and length. From there on, the lexer
+ * would produce the old tokens again, so they are kept, with their offset shifted.
+ * Edits that open or close a comment or a string literal simply keep the lexer going
+ * until the tokens agree again.
+ */
+class IncrementalLexer {
+
+	private:
+		// Tokens look at most this many characters after their end (the 'e' of "1.5e3"
+		// is read, and the character after it peeked)
+		static const size_t LOOKAHEAD = 2;
+		// The current source, and the lexer holding its tokens
+		SourceBuffer* source;
+		Lexer* lexer;
+		// Quiet mode: errors are not printed
+		bool quiet;
+		// The table interning identifiers, if any
+		SymbolTable* symbols;
+		// Set when lexing stopped on an error
+		bool failed;
+		// Number of tokens with a literal value. The lexer also holds the values of
+		// replaced tokens, until they outnumber these.
+		size_t literals;
+
+		IncrementalLexer(const IncrementalLexer&) = delete;
+		IncrementalLexer& operator=(const IncrementalLexer&) = delete;
+
+	public:
+		/**
+		 * Constructor.
+		 * Takes ownership of the given source, and generates its tokens.
+		 * Identifiers are interned in the given symbol table, if any.
+		 */
+		IncrementalLexer(SourceBuffer* source, bool quiet = false, SymbolTable* symbols = NULL) {
+			this->source = source;
+			this->quiet = quiet;
+			this->symbols = symbols;
+			this->lexer = new Lexer(source);
+			this->lexer->setQuiet(quiet);
+			this->lexer->setSymbolTable(symbols);
+			this->lexer->generateTokens();
+			this->failed = this->lexer->hasFailed();
+			this->literals = this->lexer->getLiteralCount();
+		}
+
+		~IncrementalLexer() {
+			delete this->lexer;
+			delete this->source;
+		}
+
+		/** Returns the current source. */
+		SourceBuffer* getSource() {
+			return this->source;
+		}
+		/** Returns a lexer over the current source, holding its tokens. */
+		Lexer* getLexer() {
+			return this->lexer;
+		}
+		/** Returns the tokens of the current source. */
+		vector<Token>& getTokens() {
+			return this->lexer->getTokens();
+		}
+		/** Returns true if lexing the current source stopped on an error. */
+		bool hasFailed() {
+			return this->failed;
+		}
+
+		/**
+		 * Replaces the given number of characters at the given offset of the source
+		 * with the inserted text, and updates the tokens.
+		 * The source buffer and the lexer are replaced: pointers to the old ones, and to
+		 * the old tokens, are no longer valid.
+		 */
+		TokenEdit applyEdit(size_t offset, size_t removed, const string& inserted) {
+			const char* data = this->source->data();
+			size_t size = this->source->size();
+			if ( offset > size ) {
+				offset = size;
+			}
+			if ( removed > size - offset ) {
+				removed = size - offset;
+			}
+
+			// Build the edited source
+			string text;
+			text.reserve( size - removed + inserted.length() );
+			text.append( data, offset );
+			text.append( inserted );
+			text.append( data + offset + removed, size - offset - removed );
+			SourceBuffer* edited = new SourceBuffer( move(text), this->source->getFilePath() );
+			int64_t delta = (int64_t) inserted.length() - (int64_t) removed;
+
+			// Keep the tokens that did not look at the edited text
+			vector<Token>& tokens = this->lexer->getTokens();
+			size_t lo = 0, hi = tokens.size();
+			while ( lo < hi ) {
+				size_t mid = ( lo + hi ) / 2;
+				if ( tokens[mid].getOffset() + tokens[mid].getLength() + LOOKAHEAD <= offset ) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			size_t keep = lo;
+
+			// Resume lexing after the last kept token
+			Lexer* next = new Lexer(edited);
+			next->setQuiet(this->quiet);
+			next->setSymbolTable(this->symbols);
+			// The kept tokens keep their literal values. Those of the replaced tokens are
+			// left unused, until compacted below.
+			next->takeLiterals(this->lexer);
+			if ( keep > 0 ) {
+				next->resume(&tokens[keep - 1]);
+			}
+
+			// Lex until a token matches an old token after the edit
+			vector<Token> fresh;
+			size_t j = keep;
+			size_t resync = tokens.size();
+			Token* tk;
+			while ( ( tk = next->scanToken() ) != NULL ) {
+				while ( j < tokens.size() && ( tokens[j].getOffset() < offset + removed
+						|| (int64_t) tokens[j].getOffset() + delta < (int64_t) tk->getOffset() ) ) {
+					j++;
+				}
+				if ( j < tokens.size() && (int64_t) tokens[j].getOffset() + delta == (int64_t) tk->getOffset()
+						&& tokens[j].getType() == tk->getType() && tokens[j].getSubtype() == tk->getSubtype()
+						&& tokens[j].getLength() == tk->getLength() ) {
+					resync = j;
+					break;
+				}
+				fresh.push_back(*tk);
+			}
+			// Without a match, the old tokens ran out, or the new ones stopped at the end
+			// of input or on an error
+			if ( resync == tokens.size() ) {
+				this->failed = next->hasFailed();
+			}
+
+			// Replace the old tokens between the kept ones and the match with the new ones
+			size_t replaced = resync - keep;
+			for ( size_t i = keep; i < resync; i++ ) {
+				this->literals -= tokens[i].hasLiteral();
+			}
+			for ( size_t i = 0; i < fresh.size(); i++ ) {
+				this->literals += fresh[i].hasLiteral();
+			}
+			if ( fresh.size() > replaced ) {
+				tokens.insert( tokens.begin() + resync, fresh.size() - replaced, fresh.back() );
+			} else {
+				tokens.erase( tokens.begin() + keep + fresh.size(), tokens.begin() + resync );
+			}
+			for ( size_t i = 0; i < fresh.size(); i++ ) {
+				tokens[keep + i] = fresh[i];
+			}
+			// Shift the tokens after the match
+			for ( size_t i = keep + fresh.size(); i < tokens.size(); i++ ) {
+				tokens[i].shift(delta);
+			}
+
+			// Move the tokens to the new lexer. After a match, leave it where the old
+			// one stopped, which is where the end of input is reported.
+			if ( resync < tokens.size() ) {
+				next->seek( this->lexer->getOffset() + delta );
+			}
+			next->getTokens().swap(tokens);
+			next->setPosition(0);
+			// Drop the unused literal values once they outnumber the used ones, so that
+			// memory stays proportional to the tokens over any number of edits
+			if ( next->getLiteralCount() > 2 * this->literals ) {
+				next->compactLiterals();
+			}
+			delete this->lexer;
+			delete this->source;
+			this->lexer = next;
+			this->source = edited;
+
+			TokenEdit edit;
+			edit.first = keep;
+			edit.removed = replaced;
+			edit.inserted = fresh.size();
+			return edit;
+		}
+};
+
+
+#endif
@@ -2,11 +2,15 @@
 #define __H_KEYWORDS__
 
 #include <vector>
+#include <string>
+#include <cstring>
+#include "tokentype.h"
 
 using namespace std;
 
 // Keywords and reserved words
-vector<string> KEYWORDS {
+// Recognized by keywordSubtype() below, which must be kept in sync with this list.
+const vector<string> KEYWORDS {
 
 	"function",
 	"if",
@@ -36,12 +40,99 @@ vector<string> KEYWORDS {
 	
 };
 
+/**
+ * Checks if the given image, of the given length, is the keyword kw.
+ * The caller has already checked that the lengths are equal.
+ */
+inline bool isKeywordImage(const char* image, const char* kw, size_t length) {
+	return memcmp(image, kw, length) == 0;
+}
+
+/**
+ * Returns the token subtype of the given identifier image, or ST_NONE if it is not
+ * a keyword.
+ *
+ * Keywords are told apart by their length and first character, so that at most one
+ * (or, for "read" and "real", two) comparison is needed. Nothing is allocated, and
+ * no global state is touched.
+ */
+inline TokenSubtype keywordSubtype(const char* image, size_t length) {
+	switch( length ) {
+		case 2:
+			switch( image[0] ) {
+				case 'i':
+					if ( image[1] == 'f' ) return KW_IF;
+					if ( image[1] == 'n' ) return KW_IN;
+					break;
+				case 'o':
+					if ( image[1] == 'r' ) return OP_OR;
+					break;
+			}
+			break;
+		case 3:
+			switch( image[0] ) {
+				case 'a':	if ( isKeywordImage(image, "and", 3) ) return OP_AND;	break;
+				case 'n':	if ( isKeywordImage(image, "not", 3) ) return KW_NOT;	break;
+				case 's':	if ( isKeywordImage(image, "set", 3) ) return KW_SET;	break;
+				case 'l':	if ( isKeywordImage(image, "let", 3) ) return KW_LET;	break;
+				case 'i':	if ( isKeywordImage(image, "int", 3) ) return KW_INT;	break;
+			}
+			break;
+		case 4:
+			switch( image[0] ) {
+				case 'h':	if ( isKeywordImage(image, "halt", 4) ) return KW_HALT;	break;
+				case 'c':	if ( isKeywordImage(image, "char", 4) ) return KW_CHAR;	break;
+				case 'b':	if ( isKeywordImage(image, "bool", 4) ) return KW_BOOL;	break;
+				case 'u':	if ( isKeywordImage(image, "unit", 4) ) return KW_UNIT;	break;
+				case 't':	if ( isKeywordImage(image, "true", 4) ) return KW_TRUE;	break;
+				case 'r':
+					if ( isKeywordImage(image, "read", 4) ) return KW_READ;
+					if ( isKeywordImage(image, "real", 4) ) return KW_REAL;
+					break;
+			}
+			break;
+		case 5:
+			switch( image[0] ) {
+				case 'w':
+					if ( isKeywordImage(image, "while", 5) ) return KW_WHILE;
+					if ( isKeywordImage(image, "write", 5) ) return KW_WRITE;
+					break;
+				case 'f':	if ( isKeywordImage(image, "false", 5) ) return KW_FALSE;	break;
+			}
+			break;
+		case 6:
+			if ( isKeywordImage(image, "string", 6) ) return KW_STRING;
+			break;
+		case 8:
+			if ( isKeywordImage(image, "function", 8) ) return KW_FUNCTION;
+			break;
+	}
+	return ST_NONE;
+}
+
+/**
+ * Returns the token type of the given identifier image, and sets its subtype.
+ * Keywords get their final token type: "true" and "false" are TK_BOOL, "and" is a
+ * TK_MULT_OP, "or" is a TK_ADD_OP, and all other keywords are TK_KEYWORD.
+ */
+inline TokenType classifyIdentifier(const char* image, size_t length, TokenSubtype* subtype) {
+	*subtype = keywordSubtype(image, length);
+	switch( *subtype ) {
+		case ST_NONE:	return TK_IDENTIFIER;
+		case KW_TRUE:
+		case KW_FALSE:	return TK_BOOL;
+		case OP_AND:	return TK_MULT_OP;
+		case OP_OR:		return TK_ADD_OP;
+		default:		return TK_KEYWORD;
+	}
+}
+
 /** 
  * Returns whether or not the given string parameter is a known keyword.
  */
-bool isKeyword(string s) {
-	return find( KEYWORDS.begin(), KEYWORDS.end(), s ) != KEYWORDS.end();
+inline bool isKeyword(const string& s) {
+	return keywordSubtype(s.data(), s.length()) != ST_NONE;
 }
 
 
-#endif
\ No newline at end of file
+#endif
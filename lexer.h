@@ -6,11 +6,18 @@
 #include <iostream>
 #include <string>
 #include <sstream>
-#include <fstream>
 #include <vector>
+#include <cstring>
 #include "tokentype.h"
 #include "token.h"
 #include "keywords.h"
+#include "source-buffer.h"
+#include "scan.h"
+#include "token-window.h"
+#include "dfa-lexer.h"
+#include "symbol-table.h"
+#include "literal.h"
+#include "arena.h"
 
 // NAMESPACE
 using namespace std;
@@ -24,29 +31,67 @@ class Lexer {
 	private:
 		// The file path of the source file
 		string filepath;
-		// The source file input stream
-		ifstream* in;
-		// The row of the current character being read in the file
-		int row;
-		// The column of the current character being read in the file
-		int col;
-		// The buffer: all characters read so far that haven't yet matched a token.
-		// This buffer will be reset to an empty string, when a token has been matched.
-		string buffer;
-		// The storage string.
-		// Any extra characters read and pushed to the buffer, that do not match the
-		// current token being generated. They should be popped and used next, in place
-		// of the next character in the file.
-		string storage;
+		// The source buffer.
+		// Characters are read through a plain pointer cursor over it, and token
+		// images are ranges of it.
+		SourceBuffer* source;
+		// Set if the source buffer was mapped by the lexer, which then deletes it
+		bool ownsSource = false;
+		// The next character to be read from the source buffer
+		const char* cursor;
+		// One past the last character of the source buffer
+		const char* end;
+		// Number of NUL characters read past the end of the source buffer
+		size_t overrun;
+		// The storage character.
+		// The extra character read after a token, that does not match it. It should be
+		// popped and used next, in place of the next character in the file.
+		char storage;
+		// Set if there is a character in storage
+		bool stored;
 		// Bool flag, for indicating if done or not
 		// Used to prevent re-reading the last EOF character over and over again
 		bool done;
+		// The token last created by scanToken(), valid until the next one
+		Token current = Token(TK_NONE, 0, 0);
+		// The null token returned when there are no more tokens
+		Token null = Token(TK_NONE, 0, 0);
 		// Stream vector of tokens
 		vector <Token> tokens;
-		vector <Token>::iterator iterator;
+		// The tokens read by tokenAt(): the tokens vector, or that of the lexer this
+		// one was forked from
+		vector <Token>* tokenList;
+		// Values of the literal tokens, by the index the tokens carry (see getLiteral())
+		vector <Literal> literals;
+		// The values read by getLiteral(): the literals vector, or that of the lexer
+		// this one was forked from
+		vector <Literal>* literalList;
+		// The decoded strings that had escapes
+		Arena* strings;
+		// Index of the next token to be returned by nextToken()
+		size_t position = 0;
+		// Streaming mode: tokens are lexed as they are pulled, into a bounded window,
+		// instead of all ahead of parsing into the tokens vector
+		bool streaming = false;
+		TokenWindow window;
+		// Positions pinned by mark(). The window keeps all tokens from the oldest one.
+		vector <size_t> marks;
+		// Number of tokens kept behind the current position in streaming mode,
+		// so that the parser can step back with previousToken()
+		static const size_t HISTORY = 16;
 		// Verbose output
 		bool verbose = false;
+		// Quiet mode: errors are not printed
+		bool quiet = false;
+		// Set when lexing stopped on an error
+		bool failed = false;
+		// Table-driven mode: tokens are scanned by the DfaLexer
+		bool tableDriven = false;
+		// The table interning identifiers, if any
+		SymbolTable* symbols = NULL;
 
+		Lexer(const Lexer&) = delete;
+		Lexer& operator=(const Lexer&) = delete;
 
 
 		string error(){
@@ -55,9 +100,84 @@ class Lexer {
 
 		string filePos() {
 			stringstream ss;
-			ss << ", at " << this->filepath << ":" << this->row << ":" << this->col;
+			ss << ", at " << this->filepath << ":" << this->getRow() << ":" << this->getCol();
 			return ss.str();
 		}
+		// Same as filePos(), for the character at the given offset
+		string filePos(size_t offset) {
+			stringstream ss;
+			ss << ", at " << this->filepath << ":" << this->source->getRow(offset) << ":" << this->source->getCol(offset);
+			return ss.str();
+		}
+
+		// Error reports. Lexing stops after any of them.
+		void expectedPrintable(char ch) {
+			this->failed = true;
+			if ( !this->quiet ) cout << this->error() << "Expected a printable character, found '"  << ch << "'" << this->filePos();
+		}
+		void expectedQuote(char ch) {
+			this->failed = true;
+			if ( !this->quiet ) cout << this->error() << "Expected \"'\", found '"  << ch << "'" << this->filePos();
+		}
+		void unrecognizedInput(char ch) {
+			this->failed = true;
+			if ( !this->quiet ) cout << "Lexer: Unrecognized input '" << ch << "' at " << this->getFilePath() << ":" << this->getRow() << ":" << this->getCol() << endl;
+		}
+		// The error is at the given offset in the image of the literal
+		void invalidLiteral(LiteralError error, Token* token, size_t at) {
+			this->failed = true;
+			if ( !this->quiet ) cout << "Lexer: " << literalErrorName(error) << ": " << token->getImage( this->source->data() ) << this->filePos( token->getOffset() + at ) << endl;
+		}
+
+		/**
+		 * Decodes the value of a literal token into the literals, and gives the token
+		 * its index. Returns false, after reporting the error, if the literal is not
+		 * valid. Other tokens are left as they are.
+		 */
+		bool decodeLiteral(Token* token) {
+			const char* image = this->source->data() + token->getOffset();
+			size_t length = token->getLength();
+			Literal value;
+			LiteralError error;
+			size_t at = 0;
+			switch ( token->getType() ) {
+				case TK_INTEGER:
+					error = LiteralDecoder::decodeInteger(image, length, &value.integer, &at);
+					break;
+				case TK_REAL:
+					error = LiteralDecoder::decodeReal(image, length, &value.real, &at);
+					break;
+				case TK_CHAR:
+					error = LiteralDecoder::decodeChar(image, length, &value.character, &at);
+					break;
+				case TK_STRING:
+					error = LiteralDecoder::decodeString(image, length, this->strings, &value, &at);
+					break;
+				default:
+					return true;
+			}
+			if ( error != LE_NONE ) {
+				this->invalidLiteral(error, token, at);
+				return false;
+			}
+			token->setLiteral( this->literals.size() );
+			this->literals.push_back(value);
+			return true;
+		}
+
+		/**
+		 * Adds a copy of a literal value, with the characters of a string copied to the
+		 * lexer's own strings, and gives its index to the token.
+		 */
+		void addLiteral(Token* token, Literal value) {
+			if ( token->getType() == TK_STRING && value.text != NULL ) {
+				char* text = this->strings->array<char>( value.length );
+				memcpy( text, value.text, value.length );
+				value.text = text;
+			}
+			token->setLiteral( this->literals.size() );
+			this->literals.push_back(value);
+		}
 
 	public:
 
@@ -72,67 +192,189 @@ class Lexer {
 		Lexer(string filepath) {
 			this->init(filepath);
 		}
+
+		/**
+		 * Constructor
+		 * Reads the source from the given buffer instead of a file stream.
+		 */
+		Lexer(SourceBuffer* source) {
+			this->init(source);
+		}
+
+		~Lexer() {
+			delete this->strings;
+			if ( this->ownsSource ) {
+				delete this->source;
+			}
+		}
 		
 
 		void init(string filepath) {
+			// Map the source file, owned by the lexer
+			this->init( SourceBuffer::fromFile(filepath) );
+			this->ownsSource = true;
+		}
+
+		void init(SourceBuffer* source) {
 			// Save the filepath
-			this->filepath = filepath;
-			// Create an input file stream
-			this->in = new ifstream(this->filepath);
-			// Initialize the row and col
-			this->row = 1;
-			this->col = 0;
-			// Initialize the buffer
-			this->buffer = string("");
-			// Initialie the storage string
-			this->storage = string("");
+			this->filepath = source->getFilePath();
+			// Read through a cursor over the buffer, owned by the caller
+			this->source = source;
+			this->ownsSource = false;
+			this->cursor = source->data();
+			this->end = source->data() + source->size();
+			this->overrun = 0;
+			// Initialie the storage
+			this->stored = false;
 			// Set the done lfag to false
 			this->done = false;
+			// Read the lexer's own tokens
+			this->tokenList = &this->tokens;
+			this->literalList = &this->literals;
+			this->strings = new Arena();
+		}
+
+		/**
+		 * Returns a new lexer reading the tokens generated by this one, with a position
+		 * of its own. Several parsers can then read the same tokens at once, each
+		 * through its own fork. The tokens must all be generated first, and no longer
+		 * change while forks use them.
+		 */
+		Lexer* fork() {
+			Lexer* lexer = new Lexer(this->source);
+			lexer->tokenList = this->tokenList;
+			lexer->literalList = this->literalList;
+			lexer->symbols = this->symbols;
+			lexer->quiet = this->quiet;
+			return lexer;
 		}
 
 		// Sets verbose output on or off
 		void setVerbose(bool v) {
 			this->verbose = v;
 		}
+		// Returns true if verbose output is on
+		bool isVerbose() {
+			return this->verbose;
+		}
+		// Sets quiet mode on or off. In quiet mode, errors are not printed.
+		void setQuiet(bool q) {
+			this->quiet = q;
+		}
+		// Returns true if lexing stopped on an error
+		bool hasFailed() {
+			return this->failed;
+		}
+		/**
+		 * Sets table-driven mode on or off. Must be set before reading any token.
+		 * In table-driven mode, tokens are scanned by the DfaLexer, with the same
+		 * result as the hand-written scanner.
+		 */
+		void setTableDriven(bool t) {
+			this->tableDriven = t;
+		}
+		// Returns true if in table-driven mode
+		bool isTableDriven() {
+			return this->tableDriven;
+		}
+		/**
+		 * Sets the table interning identifiers. Each identifier token then carries the
+		 * symbol ID of its image. The table can be shared with other lexers.
+		 */
+		void setSymbolTable(SymbolTable* symbols) {
+			this->symbols = symbols;
+		}
+		// Returns the table interning identifiers, or NULL
+		SymbolTable* getSymbolTable() {
+			return this->symbols;
+		}
+
+		/**
+		 * Moves to the given offset in the source, and resets the reading state, so
+		 * that lexing can start in the middle of the source.
+		 */
+		void seek(size_t offset) {
+			this->cursor = this->source->data() + offset;
+			this->overrun = 0;
+			this->stored = false;
+			this->done = false;
+			this->failed = false;
+		}
+
+		/**
+		 * Moves to the end of the given token of the source, in the state the lexer
+		 * was in right after creating it: the character after identifiers and numbers
+		 * has already been read.
+		 */
+		void resume(Token* token) {
+			size_t end = token->getOffset() + token->getLength();
+			this->seek(end);
+			if ( Lexer::readsAhead(token) ) {
+				if ( end < this->source->size() ) {
+					this->cursor++;
+					this->pushStore( this->source->data()[end] );
+				} else {
+					this->overrun++;
+					this->pushStore('\0');
+				}
+			}
+		}
+
+		/**
+		 * Returns true if the lexer reads a character after the given token, before
+		 * creating it: identifiers (including keywords) and numbers.
+		 */
+		static bool readsAhead(Token* token) {
+			switch ( token->getType() ) {
+				case TK_KEYWORD:
+				case TK_IDENTIFIER:
+				case TK_BOOL:
+				case TK_INTEGER:
+				case TK_REAL:
+					return true;
+				default:
+					// "and" and "or"
+					return token->getSubtype() == OP_AND || token->getSubtype() == OP_OR;
+			}
+		}
 
 
 		/**
 		 * Reads the next character.
-		 * Increments row and col appropriately.
 		 */
 		char next() {
-			// Get the next character
-			// noskipws: Do not skip whitespace
-			char c;
-			*this->in >> noskipws >> c;
-			// If a new line
-			if ( c == '\n' ) {
-				// Increment row, and reset col
-				this->row++;
-				this->col = 0;
-			}
-			// If not new line, increment col
-			else if ( c == '\t' ) {
-				this->col += 4;
-			} else {
-				this->col++;
+			// Past the end of the source, a NUL character is read
+			if ( this->cursor < this->end ) {
+				return *this->cursor++;
 			}
-			// Return the character
-			return c;
+			this->overrun++;
+			return '\0';
+		}
+		/**
+		 * Moves the cursor forward to p, skipping a whole run of characters at once.
+		 */
+		void skipTo(const char* p) {
+			this->cursor = p;
 		}
 		/**
 		 * Peeks for the next character.
-		 * Does not increments row and col or move on to the next character.
+		 * Does not move on to the next character.
 		 * Can be used to check what the next character is, without advancing in
 		 * the source file.
 		 */
 		char peek() {
-			return this->in->peek();
+			return ( this->cursor < this->end )? *this->cursor : EOF;
 		}
 
 
 
 
+		/**
+		 * Returns the source buffer
+		 */
+		SourceBuffer* getSource() {
+			return this->source;
+		}
 		/**
 		 * Returns the source file path
 		 */
@@ -140,69 +382,153 @@ class Lexer {
 			return this->filepath;
 		}
 		/**
-		 * Returns the row
+		 * Returns the row of the last character read, found from its offset (see
+		 * LineTable), for error messages.
 		 */
 		int getRow() {
-			return this->row;
+			return this->source->getRow( this->lastRead() );
 		}
 		/**
-		 * Returns the col
+		 * Returns the col of the last character read.
 		 */
 		int getCol() {
-			return this->col;
+			return this->source->getCol( this->lastRead() );
+		}
+		// Returns the offset of the last character read
+		size_t lastRead() {
+			size_t read = ( this->cursor - this->source->data() ) + this->overrun;
+			return ( read > 0 )? read - 1 : 0;
 		}
 
 
 
 		/**
-		 * Adds the given character to the buffer.
+		 * Stores the last character read, to be used again by the next token.
 		 */
-		void pushToBuffer(char c) {
-			this->buffer.push_back(c);
+		void pushStore(char c) {
+			this->storage = c;
+			this->stored = true;
 		}
+
 		/**
-		 * Returns the contents of the buffer.
+		 * Pops the character from storage.
 		 */
-		string getBuffer() {
-			return this->buffer;
+		char popStore() {
+			this->stored = false;
+			return this->storage;
 		}
 		/**
-		 * Flushes the buffer and returns the flushed contents.
+		 * Returns the offset in the source of the next character to be read,
+		 * which is the character in storage, if any.
 		 */
-		string flushBuffer() {
-			string b = this->buffer;
-			this->buffer = "";
-			return b;
+		size_t getOffset() {
+			return ( this->cursor - this->source->data() ) + this->overrun - ( this->stored? 1 : 0 );
+		}
+		/**
+		 * Creates a token spanning from the given offset up to the next character
+		 * to be read. The token is only valid until the next one is created.
+		 */
+		Token* createToken(TokenType type, TokenSubtype subtype, size_t start) {
+			size_t length = this->getOffset() - start;
+			this->current = Token( type, subtype, start, length );
+			if ( type == TK_IDENTIFIER && this->symbols != NULL ) {
+				this->current.setSymbol( this->symbols->intern( this->source->data() + start, length ) );
+			}
+			return &this->current;
+		}
+		/**
+		 * Creates the EOF token, with an empty image at the end of the source.
+		 */
+		Token* createEOFToken() {
+			this->current = Token( TK_EOF, this->source->size(), 0 );
+			return &this->current;
+		}
+		/**
+		 * Returns the null token, at the current position.
+		 * The same token is returned every time.
+		 */
+		Token* nullToken() {
+			this->null = Token( TK_NONE, this->getOffset(), 0 );
+			return &this->null;
+		}
+		/**
+		 * Returns the image of the given token.
+		 */
+		string getImage(Token* token) {
+			return token->getImage( this->source->data() );
+		}
+		/**
+		 * Returns a pointer to the image of the given token in the source buffer. The
+		 * image is token->getLength() characters long, and not NUL terminated.
+		 */
+		const char* getImageData(Token* token) {
+			return this->source->data() + token->getOffset();
 		}
-
-
-
 
 		/**
-		 * Pushed the character to the store stack.		
+		 * Returns the value of a literal token: a TK_INTEGER, TK_REAL, TK_CHAR or
+		 * TK_STRING token. For strings, see getString().
 		 */
-		void pushStore(char c) {
-			this->storage.push_back(c);
+		const Literal& getLiteral(Token* token) {
+			return (*this->literalList)[ token->getLiteral() ];
+		}
+		/**
+		 * Returns the characters of a string literal token, without the quotes and with
+		 * the escapes replaced, and sets their number. They are not NUL terminated.
+		 */
+		const char* getString(Token* token, size_t* length) {
+			const Literal& value = this->getLiteral(token);
+			*length = value.length;
+			return ( value.text != NULL )? value.text : this->getImageData(token) + 1;
 		}
 
 		/**
-		 * Pops the first character from the store stack.
+		 * Gives a token scanned by another lexer of the same source a copy of its
+		 * literal value in this lexer.
 		 */
-		char popStore() {
-			char c = this->storage[0];
-			this->storage = this->storage.substr(1);
-			return c;
+		void copyLiteral(Lexer* from, Token* token) {
+			if ( token->hasLiteral() ) {
+				this->addLiteral( token, from->getLiteral(token) );
+			}
 		}
 		/**
-		 * Removes and stores the last character in the buffer
+		 * Takes the literal values of another lexer, whose tokens this one takes over.
+		 * Values of the tokens scanned by this lexer are added after them.
 		 */
-		void storeFromBuffer() {
-			// Get the last char in the buffer
-			char c = this->buffer.back();
-			// Push it to the storage
-			this->pushStore(c);
-			// Set the buffer to its own substring, excluding the last character
-			this->buffer = this->buffer.substr(0, this->buffer.length() - 1);
+		void takeLiterals(Lexer* other) {
+			this->literals.swap( other->literals );
+			swap( this->strings, other->strings );
+		}
+		/**
+		 * Returns the number of literal values, including those of tokens that were
+		 * since dropped (see compactLiterals()).
+		 */
+		size_t getLiteralCount() {
+			return this->literalList->size();
+		}
+		/**
+		 * Rebuilds the literal values with only those of the lexer's tokens, in token
+		 * order, and frees the others. Values are left behind when tokens are replaced
+		 * (see IncrementalLexer).
+		 */
+		void compactLiterals() {
+			vector<Literal> old;
+			old.swap( this->literals );
+			Arena* oldStrings = this->strings;
+			this->strings = new Arena();
+			for ( size_t i = 0; i < this->tokens.size(); i++ ) {
+				Token* token = &this->tokens[i];
+				if ( token->hasLiteral() ) {
+					this->addLiteral( token, old[ token->getLiteral() ] );
+				}
+			}
+			delete oldStrings;
+		}
+		/**
+		 * Returns the given token as a string, for printing.
+		 */
+		string describe(Token* token) {
+			return token->toString(this->source);
 		}
 		/**
 		 * Returns whether or not there are characters in storage.
@@ -210,7 +536,7 @@ class Lexer {
 		 * from the storage.
 		 */
 		bool hasStore() {
-			return this->storage.length() > 0;
+			return this->stored;
 		}
 
 
@@ -220,7 +546,7 @@ class Lexer {
 		 * Returns true if the end of the input has been reached.
 		 */
 		bool eof() {
-			return this->in->eof() || this->peek() == EOF;
+			return this->cursor >= this->end;
 		}
 
 
@@ -232,67 +558,166 @@ class Lexer {
 		}
 		
 
-		vector<Token>::iterator getPosition() {
-			return this->iterator;
+		/**
+		 * Sets streaming mode on or off. Must be set before reading any token.
+		 * In streaming mode, generateTokens() is not needed: each token is lexed when
+		 * the parser first pulls it, and only a bounded window of tokens is kept (see
+		 * mark()), so memory does not grow with the size of the source.
+		 */
+		void setStreaming(bool s) {
+			this->streaming = s;
+		}
+		// Returns true if in streaming mode
+		bool isStreaming() {
+			return this->streaming;
+		}
+
+		/**
+		 * Returns the vector of generated tokens.
+		 */
+		vector<Token>& getTokens() {
+			return *this->tokenList;
+		}
+
+		size_t getPosition() {
+			return this->position;
 		}
-		void setPosition(vector<Token>::iterator it) {
-			this->iterator = it;
+		void setPosition(size_t p) {
+			this->position = p;
 		}
-		// Moves the iterator forward
+		// Moves the position forward
 		void forward() {
-			this->iterator++;
+			this->position++;
 		}
-		// Moves the iterator backwards
+		// Moves the position backwards
 		void backwards() {
-			this->iterator--;
+			this->position--;
+		}
+
+		/**
+		 * Marks the current position, so that the parser can rewind() to it later.
+		 * In streaming mode, all tokens from the oldest unreleased mark onwards are
+		 * kept in the window. Marks must be released in reverse order.
+		 */
+		size_t mark() {
+			this->marks.push_back(this->position);
+			return this->position;
+		}
+		/**
+		 * Moves back to a marked position.
+		 */
+		void rewind(size_t m) {
+			this->position = m;
+		}
+		/**
+		 * Releases a mark, allowing the window to drop the tokens it kept.
+		 */
+		void release(size_t m) {
+			for ( size_t i = this->marks.size(); i > 0; i-- ) {
+				if ( this->marks[i - 1] == m ) {
+					this->marks.erase( this->marks.begin() + (i - 1) );
+					return;
+				}
+			}
+		}
+
+		/**
+		 * Returns the token at the given index, or NULL if there is no such token.
+		 * In streaming mode, tokens up to the index are lexed if needed.
+		 */
+		Token* tokenAt(size_t i) {
+			if ( !this->streaming ) {
+				return ( i < this->tokenList->size() )? &(*this->tokenList)[i] : NULL;
+			}
+			while ( i >= this->window.end() && this->pull() ) {}
+			return this->window.contains(i)? this->window.at(i) : NULL;
 		}
-		// Returns a pointer to the token, pointed to by the iterator
+
+		// Returns a pointer to the token at the current position
 		Token* getToken() {
-			return &(*this->iterator);
+			Token* tk = this->tokenAt(this->position);
+			return ( tk != NULL )? tk : this->nullToken();
 		}
 
-		// Moves the iterator forward and returns the token
+		// Moves the position forward and returns the token
 		Token* nextToken() {
-			if ( this->iterator != this->tokens.end() ) {
-				Token* tk = &*this->iterator;
-				this->iterator++;
+			Token* tk = this->tokenAt(this->position);
+			if ( tk != NULL ) {
+				this->position++;
 				return tk;
 			} else {
-				return Token::nullToken(this->row,this->col);
+				return this->nullToken();
 			}
 		}
 		Token* previousToken() {
-			this->iterator--;
-			if ( this->iterator != this->tokens.begin() ) {
-				Token* tk = &*this->iterator;
-				return tk;
-			} else {
-				return Token::nullToken(this->row, this->col);
+			this->position--;
+			Token* tk = ( this->position != 0 )? this->tokenAt(this->position) : NULL;
+			return ( tk != NULL )? tk : this->nullToken();
+		}
+
+
+		/**
+		 * Lexes the next token into the streaming window.
+		 * Returns false if there are no more tokens.
+		 */
+		bool pull() {
+			Token* tk = this->scanToken();
+			if ( tk == NULL ) {
+				return false;
+			}
+			// Drop the tokens that can no longer be reached: those older than both the
+			// history kept behind the current position, and the oldest mark
+			size_t keep = ( this->position > HISTORY )? this->position - HISTORY : 0;
+			for ( size_t i = 0; i < this->marks.size(); i++ ) {
+				if ( this->marks[i] < keep ) {
+					keep = this->marks[i];
+				}
 			}
+			this->window.discardBefore(keep);
+			this->window.push(*tk);
+			return true;
 		}
 
 
 		/** 
 		 * Returns the next token.
 		 *
+		 * Returns the next token, or NULL if either:
+		 *  i)	End of input has been reached.
+		 * ii)	No token could by determined from the input.
+		 * iii)	A literal could not be decoded (see decodeLiteral()).
+		 */
+		Token* scanToken() {
+			// Lexing does not resume after an error
+			if ( this->failed ) {
+				return NULL;
+			}
+			Token* tk = ( this->tableDriven )? this->scanTokenTable() : this->scanTokenChars();
+			// Literals are decoded once, as they are scanned
+			if ( tk != NULL && !this->decodeLiteral(tk) ) {
+				return NULL;
+			}
+			return tk;
+		}
+
+		/**
+		 * Same as scanToken(), without decoding literals.
+		 *
 		 * The method will read a single character from the file, and using a lookahead of 1, it will determine
 		 * the type of the next token to be read.
 		 *
 		 * Once the type is determined, it will continue consuming tokens, until the token is complete.
-		 * 
-		 * Returns the next token, or a null token if either:
-		 *  i)	End of input has been reached.
-		 * ii)	No token could by determined from the input.
 		 */
-		void generateTokens() {
-
+		Token* scanTokenChars() {
 			// Loop if:
 			// 		not EOF or not empty store
 			// and	no match currently found
 			while ( !done || this->hasStore() ) {
 
 				// CURRENT TOKEN
-				Token* tk = Token::nullToken(this->row, this->col);
+				Token* tk = NULL;
+				// Offset of the first character of the token
+				size_t start = this->getOffset();
 
 				// Flag to check if a token has been matched
 				bool matched = false;
@@ -303,6 +728,10 @@ class Lexer {
 
 				// WHITESPACE SKIP
 				if ( ch == '\n' || ch == ' ' || ch == '\t' ) {
+					// Skip the rest of the whitespace run
+					if ( !this->hasStore() ) {
+						this->skipTo( Scan::whitespace(this->cursor, this->end) );
+					}
 					continue;
 				}
 
@@ -312,31 +741,20 @@ class Lexer {
 					char p = this->peek();
 					// Check if another forward slash (line comment)
 					if ( p == '/' ) {
-						do {
-							// Keep reading characters
-							ch = this->next();
-							this->pushToBuffer(ch);
-							// until an end of line/file is found
-						} while ( !(ch == '\n' || this->eof()) );
-						// Flush the buffer
-						this->flushBuffer();
+						// Skip characters until after the end of line, or until the end of file
+						const char* nl = (const char*) memchr(this->cursor, '\n', this->end - this->cursor);
+						this->skipTo( ( nl != NULL )? nl + 1 : this->end );
 						continue;
 					}
 					// Otherwise, if the peek char is an asterisk (block comment)
 					else if ( p == '*' ) {
-						do {
-							// Get the next character
-							ch = this->next();
-							this->pushToBuffer(ch);
-							// Peek the one after that
-							p = this->peek();
-						} while ( !(ch == '*' && p == '/') && !this->eof() );
-						// Keep reading characters until the read character and the peeked
-						// one indicate a closing block comment
-						// Read the next character (the peeked '/')
+						// Skip characters up to the '*' of the closing "*/", or until the end
+						// of file. The search starts at the opening '*', so "/*/" is a
+						// complete comment.
+						const char* close = Scan::commentEnd(this->cursor, this->end);
+						this->skipTo( ( close != this->end )? close + 1 : this->end );
+						// Read the next character (the closing '/')
 						this->next();
-						// Flush the buffer
-						this->flushBuffer();
 						continue;
 					}
 				}
@@ -344,13 +762,12 @@ class Lexer {
 
 				// STRING LITERALS
 				if ( ch == '"' ) {
-					// Push the double quote to the buffer
-					this->pushToBuffer(ch);
 					// Loop until we don't find anymore printable characters
 					bool ignoreNextQuote = false;
 					do {
+						// Skip the run of printable characters that cannot end the literal
+						this->skipTo( Scan::stringBody(this->cursor, this->end) );
 						ch = this->next();
-						this->pushToBuffer(ch);
 						// If a backslash is found, ignore the next dbl quote - treat is as a printable
 						if ( ch == '\\' && this->peek() == '"' ) {
 							ignoreNextQuote = true;
@@ -370,7 +787,7 @@ class Lexer {
 
 					// The last, extra character should be another double quote
 					if ( ch == '"' ) {
-						tk = new Token( TK_STRING, this->flushBuffer(), this->getRow(), this->getCol() );
+						tk = this->createToken( TK_STRING, ST_NONE, start );
 						matched = true;
 					}
 				}
@@ -378,34 +795,29 @@ class Lexer {
 
 				// CHARACTER LITERALS
 				if ( ch == '\'' ) {
-					// Push the single quote to the buffer
-					this->pushToBuffer(ch);
 					// Get hte next character
 					ch = this->next();
-					this->pushToBuffer(ch);
 					// It should be a printable
 					if ( Lexer::isPrintable(ch) ) {
 						// If the character is a backslash, accept the next character, even if it is a single quote
 						if ( ch == '\\' ) {
 							// Get the next character
 							ch = this->next();
-							this->pushToBuffer(ch);
 						}
 						// Get the next character
 						ch = this->next();
-						this->pushToBuffer(ch);
 						// It should be a single quote
 						if ( ch == '\'' ) {
 							// Create the token
-							tk = new Token( TK_CHAR, this->flushBuffer(), this->getRow(), this->getCol() );
+							tk = this->createToken( TK_CHAR, ST_NONE, start );
 							matched = true;
 						} else {
-							cout << this->error() << "Expected \"'\", found '"  << ch << "'" << this->filePos();
-							return;
+							this->expectedQuote(ch);
+							return NULL;
 						}
 					} else {
-						cout << this->error() << "Expected a printable character, found '"  << ch << "'" << this->filePos();
-						return;
+						this->expectedPrintable(ch);
+						return NULL;
 					}
 				}
 
@@ -413,55 +825,30 @@ class Lexer {
 				// IDENTIFIERS / KEYWORDS
 				// If character is an alpha char or underscore ...
 				if ( Lexer::isAlpha(ch) || Lexer::isUnderscore(ch) ) {
-					// Push character to buffer
-					this->pushToBuffer(ch);
-					// Loop until we don't find any more identifier characters
-					while ( Lexer::isIdentifierChar(ch) ) {
-						ch = this->next();
-						this->pushToBuffer(ch);
-					}
+					// Skip the run of identifier characters, and read the one after it
+					this->skipTo( Scan::identifier(this->cursor, this->end) );
+					ch = this->next();
 
 					// Store the last character read (extra)
-					this->storeFromBuffer();
+					this->pushStore(ch);
 
 					// Create the token
-					string tk_image = this->flushBuffer();
-					string tk_type = "";
-					// If the image is a keyword
-					if ( isKeyword(tk_image) ) {
-						tk_type = TK_KEYWORD;
-						// Set the type to TK_BOOL if "true" or "false"
-						if ( tk_image == "false" || tk_image == "true" ) {
-							tk_type = TK_BOOL;
-						}
-						// Set the type to TK_MULT_OP if "and"
-						else if ( tk_image == "and" ) {
-							tk_type = TK_MULT_OP;
-						}
-						// Set the type to TK_ADD_OP if "or"
-						else if ( tk_image == "or" ) {
-							tk_type = TK_ADD_OP;
-						}
-					} else {
-						// If not a keyword, then an identifier
-						tk_type = TK_IDENTIFIER;
-					}
-					tk = new Token( tk_type, tk_image, this->getRow(), this->getCol() );
+					// Keywords get their final type here ("true" is a TK_BOOL, "and" a TK_MULT_OP, ...)
+					TokenSubtype tk_subtype;
+					TokenType tk_type = classifyIdentifier( this->source->data() + start, this->getOffset() - start, &tk_subtype );
+					tk = this->createToken( tk_type, tk_subtype, start );
 					matched = true;
 				}
 
 
 				// INTEGERS AND REALS
 				if ( Lexer::isDigit(ch) ) {
-					// Push character to buffer
-					this->pushToBuffer(ch);
 					// Loop until we don't find any more digits
 					while( Lexer::isDigit(ch) ) {
 						ch = this->next();
-						this->pushToBuffer(ch);
 					}
 					// Set the type to an integer
-					string tk_type = TK_INTEGER;
+					TokenType tk_type = TK_INTEGER;
 
 					// Check for a dot, i.e. reading a real, not an integer
 					if ( ch == '.' ) {
@@ -470,7 +857,6 @@ class Lexer {
 						// Loop until we don't find any more digits
 						do {
 							ch = this->next();
-							this->pushToBuffer(ch);
 						}
 						while( Lexer::isDigit(ch) );
 						// Check if last character was an 'E' or 'e'
@@ -478,13 +864,11 @@ class Lexer {
 							char p = this->peek();
 							// check if the peek is a plus or minus
 							if ( p == '+' || p == '-' ) {
-								// if it is, get it and push it to the bufer
+								// if it is, read it
 								ch = this->next();
-								this->pushToBuffer(ch);
 								// Loop until we don't find any more digits
 								do {
 									ch = this->next();
-									this->pushToBuffer(ch);
 								}
 								while( Lexer::isDigit(ch) );
 							}
@@ -495,39 +879,33 @@ class Lexer {
 					} // End of <REAL> check
 
 					// Store the last character read (extra)
-					this->storeFromBuffer();
+					this->pushStore(ch);
 					// Create token
-					tk = new Token( tk_type, this->flushBuffer(), this->getRow(), this->getCol() );
+					tk = this->createToken( tk_type, ST_NONE, start );
 					matched = true;
 				}
 
 
 				// ASSIGNMENT OPERATOR "<-"
 				// If the character is a '<' (less than) character, and the peeked char is a '-' (minus)
-				if ( ch == '<' && this->peek() == '-' ) {
-					// Push the read character (<)
-					this->pushToBuffer(ch);
+				// (and not the character read after an identifier or number, which is lexed next)
+				if ( !matched && ch == '<' && this->peek() == '-' ) {
 					// read the peeked char
 					ch = this->next();
-					// push the peeked character (-)
-					this->pushToBuffer(ch);
 
 					// Create the token
-					tk = new Token( TK_ASSIGN_OP, this->flushBuffer(), this->getRow(), this->getCol() );
+					tk = this->createToken( TK_ASSIGN_OP, ST_NONE, start );
 					matched = true;
 				}
 
 				// Equals and not equals comparison
-				if ( (ch == '=' || ch == '!') && this->peek() == '=' ) {
-					// Push the first equals
-					this->pushToBuffer(ch);
+				if ( !matched && (ch == '=' || ch == '!') && this->peek() == '=' ) {
+					TokenSubtype tk_subtype = ( ch == '=' )? OP_EQ : OP_NE;
 					// read the peeked char
 					ch = this->next();
-					// push the peeked equals
-					this->pushToBuffer(ch);
 
 					// Create the token
-					tk = new Token( TK_REL_OP, this->flushBuffer(), this->getRow(), this->getCol() );
+					tk = this->createToken( TK_REL_OP, tk_subtype, start );
 					matched = true;
 				}
 
@@ -535,7 +913,8 @@ class Lexer {
 				// IF NO MATCH FOUND SO FAR
 				if ( !matched ) {
 					// SYNTAX SYMBOLS
-					string tk_type("");
+					TokenType tk_type = TK_NONE;
+					TokenSubtype tk_subtype = ST_NONE;
 					switch( ch ) {
 						case '#':
 							tk_type = TK_UNIT;
@@ -564,13 +943,21 @@ class Lexer {
 							break;
 						
 						case '+':
+							tk_type = TK_ADD_OP;
+							tk_subtype = OP_PLUS;
+							break;
 						case '-':
 							tk_type = TK_ADD_OP;
+							tk_subtype = OP_MINUS;
 							break;
 
 						case '*':
+							tk_type = TK_MULT_OP;
+							tk_subtype = OP_MULT;
+							break;
 						case '/':
 							tk_type = TK_MULT_OP;
+							tk_subtype = OP_DIV;
 							break;
 
 						case '=':
@@ -581,11 +968,11 @@ class Lexer {
 						case '<':
 							// Relational operator
 							tk_type = TK_REL_OP;
+							tk_subtype = ( ch == '<' )? OP_LT : OP_GT;
 							// If we peek and find an '=' symbol, add it to the rel op
 							if ( this->peek() == '=' ) {
-								// Push the initial character
-								this->pushToBuffer(ch);
-								// Get the following equals (pushed later after end of switch)
+								tk_subtype = ( ch == '<' )? OP_LE : OP_GE;
+								// Read the following equals
 								ch = this->next();
 							}
 							break;
@@ -596,37 +983,131 @@ class Lexer {
 
 					} // End of switch
 
-					// Push the last character read to the buffer
-					this->pushToBuffer(ch);
+					// If the end of the input was reached
+					if ( tk_type == TK_EOF ) {
+						// Create the EOF token, with an empty image at the end of the source
+						tk = this->createEOFToken();
+					}
 					// If a syntax symbol was found
-					if ( tk_type.length() > 0 ) {
+					else if ( tk_type != TK_NONE ) {
 						// Create the token
-						string image = (tk_type == TK_EOF)? "eof" : this->flushBuffer();
-						tk = new Token( tk_type, image, this->getRow(), this->getCol() );
+						tk = this->createToken( tk_type, tk_subtype, start );
 					}
 
 				} // End of !matched check
 
 				// If not token was matched
-				if ( tk->isNullToken() ) {
+				if ( tk == NULL ) {
 					// If not end of file, then unrecognized character was read
 					if ( !this->eof() ) {
-						cout << "Lexer: Unrecognized input '" << ch << "' at " << this->getFilePath() << ":" << this->getRow() << ":" << this->getCol() << endl;
-						return;
+						this->unrecognizedInput(ch);
+						return NULL;
 					} else {
 						// Read EOF. We are done
 						this->done = true;
 					}
 				}
 
-				// If there was a match, push the token back
-				this->tokens.push_back( *tk );
+				// If there was a match, return the token
 				if ( this->verbose == true ) {
-					cout << tk->toString() << endl;
+					cout << this->describe(tk) << endl;
 				}
+				return tk;
 
 			} // End of while loop
-			this->iterator = tokens.begin();
+			return NULL;
+		}
+
+		/**
+		 * Same as scanTokenChars(), using the DfaLexer to find the next token.
+		 * The lexer state is translated to and from a position in the source: the
+		 * character in storage, if any, is the one at that position, read ahead.
+		 */
+		Token* scanTokenTable() {
+			if ( this->done ) {
+				return NULL;
+			}
+			const char* data = this->source->data();
+			size_t size = this->source->size();
+			size_t read = ( this->cursor - data ) + this->overrun;
+			DfaResult r = DfaLexer::scan( data, size, this->getOffset() );
+
+			// Read up to the end of the token, and the character after it if needed
+			if ( r.read < read ) {
+				r.read = read;
+			}
+			this->readTo(r.read);
+			this->stored = false;
+			if ( r.read > r.end ) {
+				this->pushStore( ( r.end < size )? data[r.end] : '\0' );
+			}
+
+			Token* tk;
+			switch ( r.action ) {
+				case A_TOKEN:
+				case A_TOKEN_BEFORE:
+				case A_TOKEN_READ_AHEAD:
+				case A_TOKEN_BACK:
+					if ( r.type == TK_IDENTIFIER ) {
+						r.type = classifyIdentifier( data + r.start, r.end - r.start, &r.subtype );
+					}
+					tk = this->createToken( r.type, r.subtype, r.start );
+					break;
+				case A_UNRECOGNIZED:
+				case A_UNRECOGNIZED_BEFORE:
+					// A lone unrecognized character at the end of the input ends it
+					if ( !this->eof() ) {
+						this->unrecognizedInput(r.ch);
+						this->done = true;
+						return NULL;
+					}
+					// Fall through
+				case A_EOF:
+					tk = this->createEOFToken();
+					this->done = true;
+					break;
+				case A_EXPECTED_PRINTABLE:
+					this->expectedPrintable(r.ch);
+					return NULL;
+				default:
+					this->expectedQuote(r.ch);
+					return NULL;
+			}
+
+			if ( this->verbose == true ) {
+				cout << this->describe(tk) << endl;
+			}
+			return tk;
+		}
+
+		/**
+		 * Reads up to the given number of characters from the start of the source.
+		 */
+		void readTo(size_t read) {
+			const char* data = this->source->data();
+			size_t size = this->source->size();
+			this->cursor = data + ( ( read < size )? read : size );
+			// NUL characters read past the end
+			this->overrun = read - ( this->cursor - data );
+		}
+
+		/**
+		 * Generates all the tokens of the source, ahead of parsing.
+		 * Does nothing in streaming mode, where tokens are generated as they are pulled.
+		 */
+		void generateTokens() {
+			if ( this->streaming ) {
+				return;
+			}
+			// Most programs have fewer tokens than a quarter of their characters
+			this->tokens.reserve( this->tokens.size() + this->source->size() / 4 + 1 );
+			// and fewer literals than a 32nd
+			this->literals.reserve( this->literals.size() + this->source->size() / 32 + 1 );
+			Token* tk;
+			while ( ( tk = this->scanToken() ) != NULL ) {
+				this->tokens.push_back( *tk );
+			}
+			this->position = 0;
 		}
 
 
@@ -0,0 +1,59 @@
+#ifndef __LINE_TABLE_H__
+#define __LINE_TABLE_H__
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "scan.h"
+
+using namespace std;
+
+/**
+ * The LineTable class.
+ * The offset of the start of every line of a source, found with a single scan for new
+ * lines, so that the row and column of an offset are found by binary search instead
+ * of being counted while lexing.
+ */
+class LineTable {
+
+	private:
+		const char* data;
+		size_t size;
+		// Offset of the first character of each line
+		vector<uint32_t> starts;
+
+	public:
+		LineTable(const char* data, size_t size) {
+			this->data = data;
+			this->size = size;
+			this->starts.push_back(0);
+			Scan::lineStarts(data, data + size, data, this->starts);
+		}
+
+		// Returns the number of lines
+		size_t lines() {
+			return this->starts.size();
+		}
+
+		/**
+		 * Returns the row of the given offset, from 1. A new line character is on the
+		 * row it ends.
+		 */
+		int row(size_t offset) {
+			return upper_bound( this->starts.begin(), this->starts.end(), offset ) - this->starts.begin();
+		}
+
+		/**
+		 * Returns the column of the given offset, from 1. Tabs count as 4 columns.
+		 * Offsets past the end of the source are on the last line.
+		 */
+		int col(size_t offset) {
+			size_t start = this->starts[ this->row(offset) - 1 ];
+			size_t end = min(offset, this->size);
+			return 1 + ( offset - start ) + 3 * Scan::count( this->data + start, this->data + end, '\t' );
+		}
+};
+
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef __LITERAL_H__
+#define __LITERAL_H__
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <clocale>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#include "arena.h"
+
+using namespace std;
+
+/**
+ * The value of a literal token, decoded by the lexer (see Lexer::getLiteral()).
+ */
+struct Literal {
+	union {
+		// TK_INTEGER
+		int64_t integer;
+		// TK_REAL
+		double real;
+		// TK_CHAR
+		char character;
+		// TK_STRING: the characters between the quotes, with the escapes replaced, or
+		// NULL if there are no escapes, and the characters are those of the image
+		const char* text;
+	};
+	// TK_STRING: the number of characters
+	uint32_t length;
+};
+
+/**
+ * The errors found while decoding literals.
+ */
+enum LiteralError : unsigned char {
+	LE_NONE,
+	// An integer literal greater than the largest int64_t
+	LE_INTEGER_RANGE,
+	// A real literal too large for a double
+	LE_REAL_RANGE,
+	// A real literal with an exponent sign, but no exponent digits
+	LE_EXPONENT,
+	// A backslash followed by a character that has no escape
+	LE_ESCAPE
+};
+
+/**
+ * Returns the description of a literal error, for error messages.
+ */
+inline const char* literalErrorName(LiteralError error) {
+	switch( error ) {
+		case LE_NONE:			return "No error";
+		case LE_INTEGER_RANGE:	return "Integer literal out of range";
+		case LE_REAL_RANGE:		return "Real literal out of range";
+		case LE_EXPONENT:		return "Expected a digit in the exponent of a real literal";
+		case LE_ESCAPE:			return "Unknown escape sequence";
+		default:				return "?";
+	}
+}
+
+
+/**
+ * The LiteralDecoder class.
+ * Decodes the images of literal tokens, as matched by the lexer, into their values.
+ * On errors, the offset in the image of the offending character is set.
+ *
+ * Reals are converted with Clinger's fast path when the digits fit in 53 bits and
+ * the power of ten is exact in a double, which is then a single correctly rounded
+ * multiplication or division. Literals are short decimals, so that this covers
+ * nearly all of them. The others are left to strtod(), which is also correctly
+ * rounded, in the "C" locale, so that the decimal point is a dot whatever the
+ * LC_NUMERIC of the program.
+ */
+class LiteralDecoder {
+
+	private:
+		// Significant digits that always fit in a uint64_t
+		static const int MAX_DIGITS = 19;
+		// Exponents past this one are all out of range, or zero
+		static const int MAX_EXPONENT = 100000;
+
+		// Returns 10^e, for e from 0 to 22, all exact in a double
+		static double power(int e) {
+			static const double powers[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			return powers[e];
+		}
+
+		static bool isDigit(char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		// Returns the value of a real literal by strtod(), in the "C" locale
+		static double parseReal(const char* s, size_t length) {
+			static const locale_t C = newlocale( LC_ALL_MASK, "C", (locale_t) 0 );
+			return strtod_l( string(s, length).c_str(), NULL, C );
+		}
+
+	public:
+		/**
+		 * Returns the character of the escape sequence of a backslash and the given
+		 * character, or -1 if there is none.
+		 */
+		static int escape(char c) {
+			switch( c ) {
+				case 'n':	return '\n';
+				case 't':	return '\t';
+				case 'r':	return '\r';
+				case '0':	return '\0';
+				case '\\':
+				case '\'':
+				case '"':	return c;
+				default:	return -1;
+			}
+		}
+
+		/**
+		 * Decodes an integer literal: decimal digits.
+		 */
+		static LiteralError decodeInteger(const char* s, size_t length, int64_t* value, size_t* at) {
+			uint64_t v = 0;
+			// Up to 18 digits cannot overflow
+			if ( length <= 18 ) {
+				for ( size_t i = 0; i < length; i++ ) {
+					v = v * 10 + ( s[i] - '0' );
+				}
+				*value = v;
+				return LE_NONE;
+			}
+			for ( size_t i = 0; i < length; i++ ) {
+				unsigned d = s[i] - '0';
+				if ( v > ( (uint64_t) INT64_MAX - d ) / 10 ) {
+					*at = 0;
+					return LE_INTEGER_RANGE;
+				}
+				v = v * 10 + d;
+			}
+			*value = v;
+			return LE_NONE;
+		}
+
+		/**
+		 * Returns the exact value of mantissa * 10^exponent, if it can be found with a
+		 * single rounding. Returns false otherwise.
+		 */
+		static bool fastReal(uint64_t mantissa, int exponent, double* value) {
+			const uint64_t exact = (uint64_t) 1 << 53;
+			if ( mantissa > exact ) {
+				return false;
+			}
+			if ( mantissa == 0 ) {
+				*value = 0.0;
+				return true;
+			}
+			if ( exponent < -22 ) {
+				return false;
+			}
+			if ( exponent < 0 ) {
+				*value = (double) mantissa / LiteralDecoder::power(-exponent);
+				return true;
+			}
+			// Exponents past 22 are fine if the extra powers of ten keep the mantissa
+			// exact: 123e25 is 123000e22
+			for ( ; exponent > 22; exponent-- ) {
+				if ( mantissa > exact / 10 ) {
+					return false;
+				}
+				mantissa *= 10;
+			}
+			*value = (double) mantissa * LiteralDecoder::power(exponent);
+			return true;
+		}
+
+		/**
+		 * Decodes a real literal: digits, a dot, optional digits, and an optional
+		 * exponent of 'e' or 'E', a sign and digits.
+		 */
+		static LiteralError decodeReal(const char* s, size_t length, double* value, size_t* at) {
+			uint64_t mantissa = 0;
+			int digits = 0;
+			int exponent = 0;
+			// Set if a non-zero digit did not fit in the mantissa
+			bool truncated = false;
+			size_t i = 0;
+			bool fraction = false;
+			for ( ; i < length; i++ ) {
+				char c = s[i];
+				if ( c == '.' && !fraction ) {
+					fraction = true;
+					continue;
+				}
+				if ( !LiteralDecoder::isDigit(c) ) {
+					break;
+				}
+				if ( digits < MAX_DIGITS ) {
+					// Leading zeros are not significant
+					if ( mantissa != 0 || c != '0' ) {
+						mantissa = mantissa * 10 + ( c - '0' );
+						digits++;
+					}
+					if ( fraction ) {
+						exponent--;
+					}
+				} else {
+					truncated = truncated || c != '0';
+					if ( !fraction ) {
+						exponent++;
+					}
+				}
+			}
+
+			// Exponent
+			if ( i < length && ( s[i] == 'e' || s[i] == 'E' ) ) {
+				i++;
+				bool negative = ( i < length && s[i] == '-' );
+				if ( i < length && ( s[i] == '+' || s[i] == '-' ) ) {
+					i++;
+				}
+				if ( i == length ) {
+					*at = length;
+					return LE_EXPONENT;
+				}
+				int e = 0;
+				for ( ; i < length; i++ ) {
+					if ( e < MAX_EXPONENT ) {
+						e = e * 10 + ( s[i] - '0' );
+					}
+				}
+				exponent += negative? -e : e;
+			}
+
+			if ( truncated || !LiteralDecoder::fastReal(mantissa, exponent, value) ) {
+				*value = LiteralDecoder::parseReal(s, length);
+			}
+			if ( isinf(*value) ) {
+				*at = 0;
+				return LE_REAL_RANGE;
+			}
+			return LE_NONE;
+		}
+
+		/**
+		 * Decodes a character literal: a character, or a backslash and a character,
+		 * in single quotes.
+		 */
+		static LiteralError decodeChar(const char* s, size_t length, char* value, size_t* at) {
+			if ( length == 3 ) {
+				*value = s[1];
+				return LE_NONE;
+			}
+			int c = LiteralDecoder::escape(s[2]);
+			if ( c < 0 ) {
+				*at = 1;
+				return LE_ESCAPE;
+			}
+			*value = c;
+			return LE_NONE;
+		}
+
+		/**
+		 * Decodes a string literal: characters in double quotes, where a backslash and
+		 * the character after it are an escape sequence. A string with escapes is
+		 * written to the given arena; one without is left in the image.
+		 */
+		static LiteralError decodeString(const char* s, size_t length, Arena* arena, Literal* value, size_t* at) {
+			const char* begin = s + 1;
+			const char* end = s + length - 1;
+			value->length = end - begin;
+			const char* escape = (const char*) memchr( begin, '\\', end - begin );
+			if ( escape == NULL ) {
+				value->text = NULL;
+				return LE_NONE;
+			}
+
+			char* text = arena->array<char>( end - begin );
+			char* out = text;
+			const char* p = begin;
+			while ( escape != NULL ) {
+				memcpy( out, p, escape - p );
+				out += escape - p;
+				int c = ( escape + 1 < end )? LiteralDecoder::escape( escape[1] ) : -1;
+				if ( c < 0 ) {
+					*at = escape - s;
+					return LE_ESCAPE;
+				}
+				*out++ = c;
+				p = escape + 2;
+				escape = (const char*) memchr( p, '\\', end - p );
+			}
+			memcpy( out, p, end - p );
+			out += end - p;
+			value->text = text;
+			value->length = out - text;
+			return LE_NONE;
+		}
+};
+
+
+#endif
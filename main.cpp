@@ -4,18 +4,24 @@
 #include "lexer.h"
 #include "parser.h"
 #include "token.h"
+#include "ast-writer.h"
 
 int main(){
 	// Create the lexer, and generate the tokens from the file
-	Lexer* lexer = new Lexer("sample.sxl");
-	// lexer->setVerbose(true);
-	lexer->generateTokens();
+	Lexer lexer("sample.sxl");
+	// lexer.setVerbose(true);
+	lexer.generateTokens();
 
 	// Create the parser
-	Parser parser(lexer);
+	Parser parser(&lexer);
 	//parser.setVerbose(true);
 	try {
-		cout << parser.parseSXL()->toString() << endl;
+		ASTNode* tree = parser.parseSXL();
+		{
+			ASTWriter writer(cout);
+			writer.write(tree);
+		}
+		cout << endl;
 		cout << "\nDONE!!!!" << endl; 
 	} catch( ParseException &e ) {
 		cout << "\n" << e.what() << "\n" << endl;
@@ -0,0 +1,153 @@
+#ifndef __MEMO_TABLE_H__
+#define __MEMO_TABLE_H__
+
+#include <vector>
+#include <cstdint>
+#include "astnode.h"
+#include "parse-exception.h"
+
+using namespace std;
+
+/**
+ * The MemoTable class.
+ * Remembers the result of parsing a grammar rule at a token position: the node
+ * built, or the error thrown, and the position the parser was left at. Used by the
+ * parser in packrat mode, so that no rule is parsed twice at the same position.
+ *
+ * Results are kept in an open addressing hash table keyed by (rule, position), and
+ * the errors in a vector beside it, so that a result takes 32 bytes.
+ */
+class MemoTable {
+
+	public:
+		// The error index of a successful result
+		static const uint32_t NO_ERROR = 0xFFFFFFFF;
+
+		struct Entry {
+			// Token position the rule was parsed at
+			size_t position;
+			// The node built, or NULL if the rule failed
+			ASTNode* node;
+			// Token position the parser was left at
+			size_t end;
+			// Index of the error thrown, or NO_ERROR
+			uint32_t error;
+			// The rule, or 0 for an empty slot
+			uint32_t rule;
+		};
+
+	private:
+		vector<Entry> slots;
+		size_t count;
+		vector<ParseException> errors;
+
+		MemoTable(const MemoTable&) = delete;
+		MemoTable& operator=(const MemoTable&) = delete;
+
+		static size_t hash(uint32_t rule, size_t position) {
+			uint64_t h = ( (uint64_t) position << 5 ) ^ rule;
+			h *= 0x9E3779B97F4A7C15ULL;
+			return h ^ ( h >> 32 );
+		}
+
+		/**
+		 * Returns the slot of the given key: either the slot holding it, or the empty
+		 * slot where it would go.
+		 */
+		Entry* slot(uint32_t rule, size_t position) {
+			size_t mask = this->slots.size() - 1;
+			size_t i = MemoTable::hash(rule, position) & mask;
+			while ( this->slots[i].rule != 0 && ( this->slots[i].rule != rule || this->slots[i].position != position ) ) {
+				i = ( i + 1 ) & mask;
+			}
+			return &this->slots[i];
+		}
+
+		/**
+		 * Resizes the table to the given number of slots (a power of 2).
+		 */
+		void resize(size_t size) {
+			vector<Entry> old( size, Entry() );
+			old.swap(this->slots);
+			for ( size_t i = 0; i < old.size(); i++ ) {
+				if ( old[i].rule != 0 ) {
+					*this->slot( old[i].rule, old[i].position ) = old[i];
+				}
+			}
+		}
+
+		void store(uint32_t rule, size_t position, ASTNode* node, size_t end, uint32_t error) {
+			// Keep the table at most half full
+			if ( 2 * ( this->count + 1 ) > this->slots.size() ) {
+				this->resize( this->slots.size() * 2 );
+			}
+			Entry* e = this->slot(rule, position);
+			if ( e->rule == 0 ) {
+				this->count++;
+			}
+			e->position = position;
+			e->node = node;
+			e->end = end;
+			e->error = error;
+			e->rule = rule;
+		}
+
+	public:
+		MemoTable() {
+			this->count = 0;
+			this->slots.resize( 64, Entry() );
+		}
+
+		/**
+		 * Returns the result of the given rule at the given position, or NULL if the
+		 * rule was not parsed there yet.
+		 */
+		Entry* find(uint32_t rule, size_t position) {
+			Entry* e = this->slot(rule, position);
+			return ( e->rule != 0 )? e : NULL;
+		}
+
+		/**
+		 * Stores the result of a rule. Rules are numbered from 1.
+		 */
+		void success(uint32_t rule, size_t position, ASTNode* node, size_t end) {
+			this->store(rule, position, node, end, NO_ERROR);
+		}
+		void failure(uint32_t rule, size_t position, const ParseException& error, size_t end) {
+			this->errors.push_back(error);
+			this->store(rule, position, NULL, end, this->errors.size() - 1);
+		}
+
+		/**
+		 * Returns the error of a failed result.
+		 */
+		const ParseException& getError(Entry* e) {
+			return this->errors[e->error];
+		}
+
+		// Returns the number of results stored
+		size_t size() {
+			return this->count;
+		}
+
+		/**
+		 * Forgets all results. The table shrinks back if it grew much larger than it
+		 * was needed since the last clear, so that clearing costs about as much as the
+		 * results stored.
+		 */
+		void clear() {
+			if ( this->count == 0 ) {
+				return;
+			}
+			size_t size = this->slots.size();
+			while ( size > 64 && size >= 8 * this->count ) {
+				size /= 2;
+			}
+			this->slots.assign( size, Entry() );
+			this->count = 0;
+			this->errors.clear();
+		}
+};
+
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef __NODE_KIND_H__
+#define __NODE_KIND_H__
+
+/**
+ * AST node kinds, one per node class in astnode.h
+ */
+enum NodeKind : unsigned char {
+	NK_TYPE,
+	NK_IDENTIFIER,
+	// Function declarations
+	NK_FUNC_DECL,
+	NK_PARAM,
+	NK_PARAMS,
+	// Expressions
+	NK_EXPRESSION,
+	NK_TYPE_CAST,
+	// Literals
+	NK_INTEGER_LITERAL,
+	NK_REAL_LITERAL,
+	NK_CHAR_LITERAL,
+	NK_STRING_LITERAL,
+	NK_BOOLEAN_LITERAL,
+	NK_UNIT_LITERAL,
+	// Function calls
+	NK_FUNC_CALL,
+	NK_FUNC_PARAMS,
+	// Unary operators
+	NK_UNARY,
+	NK_UNARY_OP,
+	// Binary operators
+	NK_PLUS,
+	NK_MINUS,
+	NK_MULTIPLY,
+	NK_DIVIDE,
+	NK_OR,
+	NK_AND,
+	NK_GREATER,
+	NK_LESSER,
+	NK_EQUALS,
+	NK_NOT_EQUALS,
+	NK_GREATER_EQUALS,
+	NK_LESSER_EQUALS,
+	// Statements
+	NK_ASSIGN,
+	NK_VARIABLE_DECL,
+	NK_READ,
+	NK_WRITE,
+	NK_HALT,
+	NK_STATEMENT,
+	NK_IF,
+	NK_THEN,
+	NK_ELSE,
+	NK_WHILE,
+	NK_BLOCK,
+	NK_SXL,
+	// Number of node kinds
+	NK_COUNT
+};
+
+/**
+ * Returns the printable name of the given node kind.
+ * Type casts and function call parameters are printed as "Params", like formal
+ * parameters.
+ */
+inline const char* nodeKindName(NodeKind kind) {
+	switch( kind ) {
+		case NK_TYPE:				return "Type";
+		case NK_IDENTIFIER:			return "Identifier";
+		case NK_FUNC_DECL:			return "FunctionDecl";
+		case NK_PARAM:				return "Param";
+		case NK_PARAMS:				return "Params";
+		case NK_EXPRESSION:			return "Expression";
+		case NK_TYPE_CAST:			return "Params";
+		case NK_INTEGER_LITERAL:	return "IntegerLiteral";
+		case NK_REAL_LITERAL:		return "RealLiteral";
+		case NK_CHAR_LITERAL:		return "CharLiteral";
+		case NK_STRING_LITERAL:		return "StringLiteral";
+		case NK_BOOLEAN_LITERAL:	return "BooleanLiteral";
+		case NK_UNIT_LITERAL:		return "UnitLiteral";
+		case NK_FUNC_CALL:			return "FunctionCall";
+		case NK_FUNC_PARAMS:		return "Params";
+		case NK_UNARY:				return "Unary";
+		case NK_UNARY_OP:			return "UnaryOp";
+		case NK_PLUS:				return "Add";
+		case NK_MINUS:				return "Subt";
+		case NK_MULTIPLY:			return "Mult";
+		case NK_DIVIDE:				return "Div";
+		case NK_OR:					return "Or";
+		case NK_AND:				return "And";
+		case NK_GREATER:			return "GreaterNode";
+		case NK_LESSER:				return "LesserNode";
+		case NK_EQUALS:				return "EqualsNode";
+		case NK_NOT_EQUALS:			return "NotEqualsNode";
+		case NK_GREATER_EQUALS:		return "GreaterEqualsNode";
+		case NK_LESSER_EQUALS:		return "LesserEqualsNode";
+		case NK_ASSIGN:				return "Assignment";
+		case NK_VARIABLE_DECL:		return "VariableDecl";
+		case NK_READ:				return "Read";
+		case NK_WRITE:				return "Write";
+		case NK_HALT:				return "Halt";
+		case NK_STATEMENT:			return "Statement";
+		case NK_IF:					return "If";
+		case NK_THEN:				return "Then";
+		case NK_ELSE:				return "Else";
+		case NK_WHILE:				return "While";
+		case NK_BLOCK:				return "Block";
+		case NK_SXL:				return "SXL";
+		default:					return "";
+	}
+}
+
+#endif
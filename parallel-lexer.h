@@ -0,0 +1,211 @@
+#ifndef __PARALLEL_LEXER_H__
+#define __PARALLEL_LEXER_H__
+
+#include <vector>
+#include <thread>
+#include <cstring>
+#include "lexer.h"
+#include "scan.h"
+
+using namespace std;
+
+/**
+ * The ParallelLexer class.
+ * Generates the tokens of a large source on several threads, with the same result as
+ * Lexer::generateTokens().
+ *
+ * The source is split into chunks at line boundaries, and each chunk is lexed by its
+ * own Lexer. Tokens only hold offsets, so a chunk lexer needs nothing from the chunks
+ * before it to start (see LineTable). A chunk lexer keeps going past the
+ * end of its chunk to finish the last token, and stops at the first token starting
+ * at or after the end of the chunk. Literals are decoded by the chunk lexers, and
+ * their values copied to the lexer along with the tokens.
+ *
+ * A chunk lexer starts as if at a token boundary, which is wrong when the chunk
+ * starts inside a block comment or a string literal. The chunks are therefore
+ * stitched together in order: the first token after the end of a chunk is looked up
+ * in the next chunk's tokens. Since a token only depends on the source text from
+ * where it starts, the two lexers agree from that token on, and the rest of the next
+ * chunk can be used as is. If the token is not found, the previous chunk lexer keeps
+ * lexing serially until it finds a token in common with the next chunk.
+ */
+class ParallelLexer {
+
+	private:
+		// Sources smaller than this per thread are not worth splitting
+		static const size_t MIN_CHUNK_SIZE = 1 << 18;
+
+		struct Chunk {
+			// Range of the source covered by the chunk
+			size_t begin;
+			size_t end;
+			// The chunk lexer
+			Lexer* lexer;
+			// Tokens starting in the chunk, followed by the first token after it
+			vector<Token> tokens;
+			// Set if the chunk lexer reached a token after the chunk, or EOF
+			bool complete;
+		};
+
+		/**
+		 * Lexes the tokens of a chunk, until the first token after the end of the chunk.
+		 */
+		static void lexChunk(Chunk* chunk) {
+			chunk->lexer->seek(chunk->begin);
+			chunk->complete = false;
+			chunk->tokens.reserve( ( chunk->end - chunk->begin ) / 4 + 1 );
+			Token* tk;
+			while ( ( tk = chunk->lexer->scanToken() ) != NULL ) {
+				chunk->tokens.push_back(*tk);
+				if ( tk->getOffset() >= chunk->end || tk->isEOF() ) {
+					chunk->complete = true;
+					break;
+				}
+			}
+		}
+
+		/**
+		 * Appends tokens scanned by a chunk lexer to the tokens of the lexer, with
+		 * their literal values.
+		 */
+		static void append(Lexer* lexer, Lexer* from, const Token* begin, const Token* end) {
+			vector<Token>& tokens = lexer->getTokens();
+			for ( const Token* tk = begin; tk != end; tk++ ) {
+				tokens.push_back(*tk);
+				lexer->copyLiteral( from, &tokens.back() );
+			}
+		}
+
+		/**
+		 * Runs the given function on every chunk, one thread per chunk.
+		 */
+		static void forEachChunk(vector<Chunk>& chunks, void (*f)(Chunk*)) {
+			vector<thread> workers;
+			for ( size_t i = 1; i < chunks.size(); i++ ) {
+				workers.push_back( thread(f, &chunks[i]) );
+			}
+			f(&chunks[0]);
+			for ( size_t i = 0; i < workers.size(); i++ ) {
+				workers[i].join();
+			}
+		}
+
+	public:
+		/**
+		 * Generates the tokens of the lexer's source, using up to the given number of
+		 * threads (0 for one per hardware thread).
+		 * The tokens are stored in the lexer, as with lexer->generateTokens().
+		 */
+		static void generateTokens(Lexer* lexer, unsigned threads = 0) {
+			// Tokens are pulled one at a time in streaming mode
+			if ( lexer->isStreaming() ) {
+				return;
+			}
+			if ( threads == 0 ) {
+				threads = thread::hardware_concurrency();
+			}
+			SourceBuffer* source = lexer->getSource();
+			const char* data = source->data();
+			size_t size = source->size();
+
+			// Split the source in chunks, each ending after a new line
+			size_t count = size / MIN_CHUNK_SIZE;
+			if ( count > threads ) count = threads;
+			vector<Chunk> chunks;
+			size_t begin = 0;
+			for ( size_t i = 1; i <= count && begin < size; i++ ) {
+				size_t end = size;
+				if ( i < count ) {
+					const char* nl = (const char*) memchr(data + size * i / count, '\n', size - size * i / count);
+					end = ( nl != NULL )? nl + 1 - data : size;
+				}
+				if ( end <= begin ) continue;
+				Chunk chunk;
+				chunk.begin = begin;
+				chunk.end = end;
+				chunk.lexer = NULL;
+				chunk.complete = false;
+				chunks.push_back(chunk);
+				begin = end;
+			}
+
+			// Not worth it: lex serially
+			if ( chunks.size() < 2 ) {
+				lexer->generateTokens();
+				return;
+			}
+
+			// Create the chunk lexers. Only the first chunk is known to start at a
+			// token boundary, so errors in the other chunks may not be real.
+			for ( size_t i = 0; i < chunks.size(); i++ ) {
+				chunks[i].lexer = new Lexer(source);
+				chunks[i].lexer->setQuiet( i > 0 );
+				chunks[i].lexer->setTableDriven( lexer->isTableDriven() );
+				chunks[i].lexer->setSymbolTable( lexer->getSymbolTable() );
+			}
+
+			// Lex the chunks
+			forEachChunk(chunks, lexChunk);
+
+			// Stitch the chunks together
+			vector<Token>& tokens = lexer->getTokens();
+			tokens.clear();
+			tokens.reserve( size / 4 + 1 );
+			append( lexer, chunks[0].lexer, chunks[0].tokens.data(), chunks[0].tokens.data() + chunks[0].tokens.size() );
+			// The lexer whose state is right after the last token in the tokens vector
+			Lexer* current = chunks[0].lexer;
+			bool finished = !chunks[0].complete || tokens.empty() || tokens.back().isEOF();
+
+			for ( size_t i = 1; i < chunks.size() && !finished; i++ ) {
+				Chunk& chunk = chunks[i];
+				size_t j = 0;
+
+				// Lex serially until a token in common with the chunk is found, or the
+				// lexer leaves the chunk
+				while ( true ) {
+					Token last = tokens.back();
+					// Look for the last token among the chunk tokens
+					while ( j < chunk.tokens.size() && chunk.tokens[j].getOffset() < last.getOffset() ) {
+						j++;
+					}
+					if ( chunk.complete && j < chunk.tokens.size() && chunk.tokens[j].getOffset() == last.getOffset()
+							&& chunk.tokens[j].getType() == last.getType() && chunk.tokens[j].getLength() == last.getLength() ) {
+						// In sync: use the rest of the chunk
+						append( lexer, chunk.lexer, chunk.tokens.data() + j + 1, chunk.tokens.data() + chunk.tokens.size() );
+						current = chunk.lexer;
+						break;
+					}
+					if ( last.getOffset() >= chunk.end || last.isEOF() ) {
+						// Left the chunk without finding a token in common
+						break;
+					}
+					// Out of sync: lex the next token serially
+					current->setQuiet(false);
+					Token* tk = current->scanToken();
+					if ( tk == NULL ) {
+						// Lexing stopped on an error
+						finished = true;
+						break;
+					}
+					tokens.push_back(*tk);
+					lexer->copyLiteral( current, &tokens.back() );
+				}
+				if ( tokens.back().isEOF() ) {
+					finished = true;
+				}
+			}
+
+			for ( size_t i = 0; i < chunks.size(); i++ ) {
+				delete chunks[i].lexer;
+			}
+			if ( lexer->isVerbose() ) {
+				for ( size_t i = 0; i < tokens.size(); i++ ) {
+					cout << lexer->describe(&tokens[i]) << endl;
+				}
+			}
+			lexer->setPosition(0);
+		}
+};
+
+
+#endif
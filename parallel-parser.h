@@ -0,0 +1,203 @@
+#ifndef __PARALLEL_PARSER_H__
+#define __PARALLEL_PARSER_H__
+
+#include <vector>
+#include <thread>
+#include "lexer.h"
+#include "parser.h"
+
+using namespace std;
+
+/**
+ * The ParallelParser class.
+ * Parses a program on several threads, with the same result as Parser::parseSXL().
+ *
+ * The tokens are pre-scanned for top level statement boundaries: a ';' or a '}' at
+ * brace depth 0. The statements are split in ranges of about the same number of
+ * tokens, ending at such boundaries, and each range is parsed by its own Parser,
+ * reading the tokens through its own fork of the lexer, into its own arena. The
+ * statements are then added to a single SXLNode, in source order, and the range
+ * arenas are adopted by the parser's arena.
+ *
+ * A range parser checks that its last statement ends exactly at the end of the
+ * range, so that the next range is known to start where the serial parser would
+ * start a statement. If a range fails that check, or has a syntax error, the
+ * whole program is parsed again serially, for the same tree or error.
+ */
+class ParallelParser {
+
+	private:
+		// Programs with fewer tokens than this per thread are not worth splitting
+		static const size_t MIN_RANGE_TOKENS = 1 << 15;
+
+		struct Range {
+			// Token positions of the first statement, and after the last one
+			size_t begin;
+			size_t end;
+			// The range parser, its lexer and its arena
+			Parser* parser;
+			Lexer* lexer;
+			Arena* arena;
+			// The statements parsed
+			vector<ASTNode*> statements;
+			// Set if the statements end exactly at the end of the range
+			bool complete;
+		};
+
+		/**
+		 * Parses the statements of a range.
+		 */
+		static void parseRange(Range* range) {
+			range->complete = false;
+			range->lexer->setPosition(range->begin);
+			try {
+				while ( range->lexer->getPosition() < range->end ) {
+					range->statements.push_back( range->parser->parseTopLevelStatement() );
+				}
+			} catch( ParseException &e ) {
+				return;
+			}
+			range->complete = ( range->lexer->getPosition() == range->end );
+		}
+
+		/**
+		 * Runs the given function on every range, one thread per range.
+		 */
+		static void forEachRange(vector<Range>& ranges, void (*f)(Range*)) {
+			vector<thread> workers;
+			for ( size_t i = 1; i < ranges.size(); i++ ) {
+				workers.push_back( thread(f, &ranges[i]) );
+			}
+			f(&ranges[0]);
+			for ( size_t i = 0; i < workers.size(); i++ ) {
+				workers[i].join();
+			}
+		}
+
+	public:
+		/**
+		 * Parses the program of the given parser, from its lexer's current position,
+		 * using up to the given number of threads (0 for one per hardware thread).
+		 * The range parsers use the same modes as the given parser, and the nodes end
+		 * up in its arena.
+		 */
+		static ASTNode* parseSXL(Parser* parser, unsigned threads = 0) {
+			Lexer* lexer = parser->getLexer();
+			// Tokens are pulled one at a time in streaming mode, and verbose output
+			// must come in order
+			if ( lexer->isStreaming() || parser->isVerbose() ) {
+				return parser->parseSXL();
+			}
+			if ( threads == 0 ) {
+				threads = thread::hardware_concurrency();
+			}
+			vector<Token>& tokens = lexer->getTokens();
+			size_t start = lexer->getPosition();
+			// Without an EOF token, lexing failed, and so will parsing
+			if ( tokens.size() <= start || !tokens.back().isEOF() ) {
+				return parser->parseSXL();
+			}
+			// The tokens before the EOF token
+			size_t size = tokens.size() - 1;
+
+			// Split the statements in ranges, each ending after a ';' or '}' at depth 0
+			size_t count = ( size > start )? ( size - start ) / MIN_RANGE_TOKENS : 0;
+			if ( count > threads ) count = threads;
+			vector<Range> ranges;
+			size_t begin = start;
+			size_t i = start;
+			int depth = 0;
+			for ( size_t r = 1; r < count && i < size; r++ ) {
+				// Scan up to the target end of the range, then on to the next boundary
+				size_t target = start + ( size - start ) * r / count;
+				for ( ; i < size; i++ ) {
+					TokenType type = tokens[i].getType();
+					if ( type == TK_OPEN_BLOCK ) {
+						depth++;
+					} else if ( type == TK_CLOSE_BLOCK ) {
+						depth--;
+					}
+					if ( i >= target && depth == 0 && ( type == TK_SEMICOLON || type == TK_CLOSE_BLOCK ) ) {
+						i++;
+						break;
+					}
+				}
+				if ( i >= size ) break;
+				Range range;
+				range.begin = begin;
+				range.end = i;
+				range.parser = NULL;
+				range.lexer = NULL;
+				range.arena = NULL;
+				range.complete = false;
+				ranges.push_back(range);
+				begin = i;
+			}
+			Range last;
+			last.begin = begin;
+			last.end = size;
+			last.parser = NULL;
+			last.lexer = NULL;
+			last.arena = NULL;
+			last.complete = false;
+			ranges.push_back(last);
+
+			// Not worth it: parse serially
+			if ( ranges.size() < 2 ) {
+				return parser->parseSXL();
+			}
+
+			// Create the range parsers
+			for ( size_t r = 0; r < ranges.size(); r++ ) {
+				Range& range = ranges[r];
+				range.lexer = lexer->fork();
+				range.arena = new Arena();
+				range.parser = new Parser(range.lexer, range.arena);
+				range.parser->setPredictive( parser->isPredictive() );
+				range.parser->setPrecedenceClimbing( parser->isPrecedenceClimbing() );
+				range.parser->setPackrat( parser->isPackrat() );
+				range.parser->setLazy( parser->isLazy() );
+			}
+
+			// Parse the ranges
+			forEachRange(ranges, parseRange);
+
+			bool complete = true;
+			for ( size_t r = 0; r < ranges.size(); r++ ) {
+				complete = complete && ranges[r].complete;
+			}
+
+			ASTNode* node = NULL;
+			if ( complete ) {
+				// Merge the statements, in order
+				node = parser->getArena()->make<SXLNode>( parser->getArena() );
+				for ( size_t r = 0; r < ranges.size(); r++ ) {
+					for ( size_t j = 0; j < ranges[r].statements.size(); j++ ) {
+						node->addChild( ranges[r].statements[j] );
+					}
+					parser->getArena()->adopt( ranges[r].arena );
+				}
+				// After the EOF token, as parseSXL() leaves it
+				lexer->setPosition( tokens.size() );
+				node->setTokens( start, tokens.size(), tokens.size() );
+			}
+
+			for ( size_t r = 0; r < ranges.size(); r++ ) {
+				delete ranges[r].parser;
+				if ( !complete ) {
+					delete ranges[r].arena;
+				}
+				delete ranges[r].lexer;
+			}
+
+			if ( !complete ) {
+				// Parse serially, for the same tree or error
+				lexer->setPosition(start);
+				return parser->parseSXL();
+			}
+			return node;
+		}
+};
+
+
+#endif
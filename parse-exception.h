@@ -3,22 +3,75 @@
 
 #include <exception>
 #include <string>
-#include <sstream>
+#include <vector>
+#include <iostream>
 #include "token.h"
+#include "diagnostic.h"
 
 class ParseException : public exception {
 	public:
-		ParseException(string msg) {
-			stringstream ss;
-			ss << "ParseError: " << msg;
-			this->msg = ss.str();
+		/**
+		 * Constructor.
+		 * Token images and positions are read from the given source when the message
+		 * is first asked for, so the source must outlive the exception.
+		 */
+		ParseException(const Diagnostic& diagnostic, SourceBuffer* source) : diagnostic(diagnostic) {
+			this->source = source;
 		}
 		virtual const char* what() const throw() {
+			if ( this->msg.empty() ) {
+				this->msg = "ParseError: " + this->diagnostic.format(this->source);
+			}
 			return this->msg.c_str();
 		}
+		// Returns the error, as data
+		const Diagnostic& getDiagnostic() const {
+			return this->diagnostic;
+		}
 	private:
-		string msg;
+		Diagnostic diagnostic;
+		SourceBuffer* source;
+		// The message, formatted by the first call to what()
+		mutable string msg;
+};
+
+
+/**
+ * The DiagnosticCollector class.
+ * Collects the errors of a parse that goes on after each one (see
+ * Parser::parseSXL(DiagnosticCollector&)).
+ */
+class DiagnosticCollector {
+	private:
+		vector<ParseException> errors;
+
+	public:
+		void add(const ParseException& e) {
+			this->errors.push_back(e);
+		}
+
+		// Returns the number of errors
+		size_t size() {
+			return this->errors.size();
+		}
+		// Checks if there were any errors
+		bool hasErrors() {
+			return !this->errors.empty();
+		}
+		// Returns the i-th error
+		const ParseException& at(size_t i) {
+			return this->errors[i];
+		}
+
+		/**
+		 * Prints the messages of the errors, one per line.
+		 */
+		void print(ostream& out) {
+			for ( size_t i = 0; i < this->errors.size(); i++ ) {
+				out << this->errors[i].what() << "\n";
+			}
+		}
 };
 
 
-#endif
\ No newline at end of file
+#endif
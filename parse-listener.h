@@ -0,0 +1,107 @@
+#ifndef __PARSE_LISTENER_H__
+#define __PARSE_LISTENER_H__
+
+#include <cstdint>
+#include "astnode.h"
+#include "ast-visitor.h"
+
+using namespace std;
+
+/**
+ * The ParseListener class.
+ * Receives the structure of a program as a sequence of events, in the order of a
+ * depth first walk of its tree (see Parser::parseEvents()): enter and leave around
+ * each node with children, and one event for each node with text.
+ *
+ * A listener derives from ParseListener<Listener> and declares the events it needs,
+ * which are found at compile time. By default, identifiers, types, literals and unary
+ * operators all go to text(). Text, and the characters of string values, are only
+ * valid during the event.
+ */
+template<class Listener>
+class ParseListener {
+
+	private:
+		Listener* listener() {
+			return static_cast<Listener*>(this);
+		}
+
+	public:
+		// Before the children of a node, and after them
+		void enter(NodeKind) {}
+		void leave(NodeKind) {}
+
+		// A node with text
+		void text(NodeKind, const char*, size_t) {}
+
+		void identifier(const char* text, size_t length, uint32_t) {
+			this->listener()->text(NK_IDENTIFIER, text, length);
+		}
+		void type(const char* text, size_t length) {
+			this->listener()->text(NK_TYPE, text, length);
+		}
+		// A literal, of kind NK_INTEGER_LITERAL to NK_UNIT_LITERAL, with its image and
+		// its value (see getLiteral())
+		void literal(NodeKind kind, const char* text, size_t length, const Literal&) {
+			this->listener()->text(kind, text, length);
+		}
+		void unaryOperator(const char* text, size_t length) {
+			this->listener()->text(NK_UNARY_OP, text, length);
+		}
+};
+
+
+/**
+ * The ParseEventEmitter class.
+ * Walks a tree, sending its events to a listener.
+ */
+template<class Listener>
+class ParseEventEmitter : public ASTVisitor< ParseEventEmitter<Listener> > {
+
+	private:
+		Listener* listener;
+
+	public:
+		ParseEventEmitter(Listener* listener) {
+			this->listener = listener;
+		}
+
+		bool enter(ASTNode* node) {
+			this->listener->enter( node->getKind() );
+			return true;
+		}
+		void leave(ASTNode* node) {
+			this->listener->leave( node->getKind() );
+		}
+
+		// Nodes with text have no children
+		bool enterIdentifier(IdentifierNode* node) {
+			this->listener->identifier( node->getText(), node->getTextLength(), node->getSymbol() );
+			return false;
+		}
+		bool enterType(TypeNode* node) {
+			this->listener->type( node->getText(), node->getTextLength() );
+			return false;
+		}
+		bool enterUnaryOp(UnaryOpNode* node) {
+			this->listener->unaryOperator( node->getText(), node->getTextLength() );
+			return false;
+		}
+		#define LITERAL(Name, Class) \
+			bool enter##Name(Class* node) { \
+				Literal value; \
+				getLiteral(node, &value); \
+				this->listener->literal( node->getKind(), node->getText(), node->getTextLength(), value ); \
+				return false; \
+			}
+		LITERAL(IntegerLiteral, IntegerLiteralNode)
+		LITERAL(RealLiteral, RealLiteralNode)
+		LITERAL(CharLiteral, CharLiteralNode)
+		LITERAL(StringLiteral, StringLiteralNode)
+		LITERAL(BooleanLiteral, BooleanLiteralNode)
+		LITERAL(UnitLiteral, UnitLiteralNode)
+		#undef LITERAL
+};
+
+
+#endif
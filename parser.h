@@ -7,41 +7,336 @@
 #include "token.h"
 #include "parse-exception.h"
 #include "astnode.h"
+#include "memo-table.h"
+#include "arena.h"
+#include "flat-ast.h"
+#include "incremental-lexer.h"
+#include "parse-listener.h"
 
 class Parser {
 
 private:
 	Lexer* lexer;
+	// The arena the nodes are allocated in, and whether the parser owns it
+	Arena* arena;
+	bool ownsArena;
+
+	Parser(const Parser&) = delete;
+	Parser& operator=(const Parser&) = delete;
 	string tree = "";
-	bool verbose;
+	bool verbose = false;
+	// Set to choose productions by looking ahead, instead of trying them in turn
+	bool predictive = false;
+	// Set to parse binary operators by precedence climbing
+	bool precedenceClimbing = false;
+	// Set to remember the result of each rule at each position
+	bool packrat = false;
+	MemoTable memo;
+	// Set to leave function bodies unparsed until they are asked for
+	bool lazy = false;
+	// Position after the last token looked at, in the statement or block being parsed
+	size_t reach = 0;
+	// Nodes reused by reparse() after the edit, and so to be shifted
+	vector<ASTNode*> shifted;
+
+	// Rules memoized in packrat mode
+	enum MemoRule {
+		MEMO_STATEMENT = 1,
+		MEMO_EXPRESSION,
+		MEMO_SIMPLE_EXPRESSION,
+		MEMO_TERM,
+		MEMO_FACTOR,
+		MEMO_IDENTIFIER
+	};
+	typedef ASTNode* (Parser::*Rule)();
+
+	/**
+	 * Returns an error at the given token, of the given index (by default the current
+	 * position, where the parser steps back to before throwing).
+	 */
+	ParseException error(DiagnosticCode code, uint32_t expected, Token* token, size_t index) {
+		return ParseException( Diagnostic(code, expected, index, token), lexer->getSource() );
+	}
+	ParseException error(DiagnosticCode code, uint32_t expected, Token* token) {
+		return error( code, expected, token, lexer->getPosition() );
+	}
+	// Returns an error for a token other than the expected ones
+	ParseException expected(uint32_t expected, Token* token) {
+		return error(DG_EXPECTED, expected, token);
+	}
+
+	// Returns the given token as a string, for error messages
+	string describe(Token* token) {
+		return lexer->describe(token);
+	}
 
-	ParseException error(string msg) {
-		ParseException e(msg);
-		return e;
+	// Makes a node in the arena
+	template<class T, class... Args>
+	T* make(Args&&... args) {
+		return arena->make<T>( arena, forward<Args>(args)... );
 	}
 
 public:
-	Parser(Lexer* l) {
+	/**
+	 * Version of the parser's trees, to be raised by any change that makes it build a
+	 * different tree for the same source, or reject a source it accepted, so that
+	 * cached trees are not reused.
+	 * 2: literals are decoded by the lexer, which rejects those out of range.
+	 */
+	static const uint32_t VERSION = 2;
+
+	/**
+	 * Creates a parser reading tokens from the given lexer.
+	 * Nodes are allocated in the given arena, or if none is given, in an arena owned by
+	 * the parser, so that the tree is freed along with the parser.
+	 */
+	Parser(Lexer* l, Arena* arena = NULL) {
 		this->lexer = l;
+		this->ownsArena = ( arena == NULL );
+		this->arena = ( arena != NULL )? arena : new Arena();
+	}
+	~Parser() {
+		if ( this->ownsArena ) {
+			delete this->arena;
+		}
+	}
+	// Returns the arena the nodes are allocated in
+	Arena* getArena() {
+		return this->arena;
+	}
+	// Returns the lexer the tokens are read from
+	Lexer* getLexer() {
+		return this->lexer;
+	}
+	/**
+	 * Sets the lexer the tokens are read from, e.g. the new lexer of an
+	 * IncrementalLexer after an edit.
+	 */
+	void setLexer(Lexer* l) {
+		this->lexer = l;
+		memo.clear();
 	}
 	void out(string s) {
 		if ( verbose ) {
 			cout << s << endl;
 		}
 	}
+	// Same as above, without making a string when not verbose
+	void out(const char* s) {
+		if ( verbose ) {
+			cout << s << endl;
+		}
+	}
 	void setVerbose(bool v) {
 		verbose = v;
 	}
+	bool isVerbose() {
+		return verbose;
+	}
+	/**
+	 * Sets predictive mode on or off.
+	 * In predictive mode, statements and factors are told apart by their first token
+	 * (and, for identifiers and parentheses, the token after it), instead of trying
+	 * each production until one does not throw. A ParseException is then only thrown
+	 * on an actual syntax error. The trees built are the same in both modes.
+	 */
+	void setPredictive(bool p) {
+		predictive = p;
+	}
+	bool isPredictive() {
+		return predictive;
+	}
+	/**
+	 * Sets precedence climbing on or off.
+	 * With precedence climbing, a chain of operators of the same precedence is parsed
+	 * in a loop, and builds left associative nodes: "a - b - c" is (a - b) - c. Any
+	 * number of operators may be chained at each level, so "a + b + c" and "a < b < c"
+	 * are accepted. Otherwise, terms are right associative, and a simple expression or
+	 * an expression has at most one additive or relational operator.
+	 */
+	void setPrecedenceClimbing(bool p) {
+		precedenceClimbing = p;
+	}
+	bool isPrecedenceClimbing() {
+		return precedenceClimbing;
+	}
+	/**
+	 * Sets packrat mode on or off.
+	 * In packrat mode, the result of the rules that are tried more than once at the
+	 * same position (statements, expressions, terms, factors and identifiers) is
+	 * remembered: the node, or the error, and the position it ends at. Trying a rule
+	 * again returns the same result without parsing, so that backtracking takes
+	 * linear time. The results are dropped after each top level statement.
+	 */
+	void setPackrat(bool p) {
+		packrat = p;
+	}
+	bool isPackrat() {
+		return packrat;
+	}
+	/**
+	 * Sets lazy mode on or off.
+	 * In lazy mode, the body of a function declaration is skipped by brace matching,
+	 * and left as an empty block recording its tokens, until parseBody() is called.
+	 * Signatures are parsed as usual. Syntax errors in a body are only found when the
+	 * body is parsed. Has no effect in streaming mode, where skipped tokens are gone.
+	 */
+	void setLazy(bool l) {
+		lazy = l;
+	}
+	bool isLazy() {
+		return lazy;
+	}
+
+
+	/**
+	 * Parses a rule, or returns its result if it was already parsed at the current
+	 * position.
+	 */
+	ASTNode* memoize(MemoRule rule, Rule parse) {
+		size_t start = lexer->getPosition();
+
+		MemoTable::Entry* e = memo.find(rule, start);
+		if ( e != NULL ) {
+			lexer->setPosition( e->end );
+			reach = max(reach, e->end);
+			if ( e->node == NULL ) {
+				throw memo.getError(e);
+			}
+			return e->node;
+		}
+
+		try {
+			ASTNode* node = (this->*parse)();
+			memo.success( rule, start, node, lexer->getPosition() );
+			return node;
+		} catch( ParseException &error ) {
+			memo.failure( rule, start, error, lexer->getPosition() );
+			throw;
+		}
+	}
+
+	/**
+	 * Parses a rule, and records in the node the tokens it was parsed from: those
+	 * consumed, and those looked at after them (see reparse()).
+	 */
+	ASTNode* parseRanged(Rule parse) {
+		size_t start = lexer->getPosition();
+		size_t outer = reach;
+		reach = start;
+		ASTNode* node;
+		try {
+			node = (this->*parse)();
+		} catch( ParseException &e ) {
+			reach = max(outer, reach);
+			throw;
+		}
+		size_t end = lexer->getPosition();
+		// A node remembered in packrat mode looked at its tokens the first time
+		if ( node->hasTokens() ) {
+			reach = max( reach, node->getTokenReach() );
+		}
+		node->setTokens( start, end, max(reach, end) );
+		reach = max(outer, reach);
+		return node;
+	}
 	Token* nextToken() {
 		Token* token = lexer->nextToken();
-		out( "> NEXT: " + token->toString() );
+		if ( lexer->getPosition() > reach ) {
+			reach = lexer->getPosition();
+		}
+		if ( verbose ) {
+			out( "> NEXT: " + describe(token) );
+		}
 		return token;
 	}
 	Token* previousToken() {
 		Token* token = lexer->previousToken();
-		//out( "< PREV: " + token->toString() );
+		//out( "< PREV: " + describe(token) );
 		return token;
 	}
+	// Returns the token the given number of tokens ahead, without moving
+	Token* peekToken(size_t ahead = 0) {
+		if ( lexer->getPosition() + ahead + 1 > reach ) {
+			reach = lexer->getPosition() + ahead + 1;
+		}
+		Token* token = lexer->tokenAt( lexer->getPosition() + ahead );
+		return ( token != NULL )? token : lexer->nullToken();
+	}
+
+
+	// Returns the precedence of the token as a binary operator, or 0 if it is not one
+	static int precedence(Token* token) {
+		switch( token->getType() ) {
+			case TK_REL_OP:		return 1;
+			case TK_ADD_OP:		return 2;
+			case TK_MULT_OP:	return 3;
+			default:			return 0;
+		}
+	}
+
+	// Returns true if the token is a type keyword
+	static bool isType(Token* token) {
+		if ( token->getType() != TK_KEYWORD ) {
+			return false;
+		}
+		switch( token->getSubtype() ) {
+			case KW_INT:
+			case KW_REAL:
+			case KW_BOOL:
+			case KW_CHAR:
+			case KW_STRING:
+			case KW_UNIT:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Returns true if the token is a literal
+	static bool isLiteral(Token* token) {
+		switch( token->getType() ) {
+			case TK_INTEGER:
+			case TK_REAL:
+			case TK_BOOL:
+			case TK_CHAR:
+			case TK_STRING:
+			case TK_UNIT:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Returns true if the token is a unary operator
+	static bool isUnaryOp(Token* token) {
+		return token->is(TK_ADD_OP, OP_PLUS) || token->is(TK_ADD_OP, OP_MINUS) || token->is(TK_KEYWORD, KW_NOT);
+	}
+
+	// Returns true if an expression can start with the token
+	static bool startsExpression(Token* token) {
+		return isLiteral(token) || token->getType() == TK_IDENTIFIER || token->getType() == TK_OPEN_PAREN || isUnaryOp(token);
+	}
+
+	// Returns true if a statement can start with the token
+	static bool startsStatement(Token* token) {
+		if ( token->getType() == TK_KEYWORD ) {
+			switch( token->getSubtype() ) {
+				case KW_FUNCTION:
+				case KW_SET:
+				case KW_LET:
+				case KW_READ:
+				case KW_WRITE:
+				case KW_IF:
+				case KW_WHILE:
+				case KW_HALT:
+					return true;
+				default:
+					break;
+			}
+		}
+		return token->getType() == TK_OPEN_BLOCK || startsExpression(token);
+	}
 
 
 
@@ -60,20 +355,23 @@ public:
 		// Check if the token is a relational operator
 		if ( token->getType() != TK_REL_OP ) {
 			previousToken();
-			throw error("a relational operator");
+			throw expected( EX_RELATIONAL_OP, token );
 		}
 		
-		if ( token->getImage() == ">" ) {	return new GreaterNode(); }
-		if ( token->getImage() == "<" ) {	return new LesserNode(); }
-		if ( token->getImage() == "==" ) {	return new EqualsNode(); }
-		if ( token->getImage() == "!=" ) {	return new NotEqualsNode(); }
-		if ( token->getImage() == ">=" ) {	return new GreaterEqualsNode(); }
-		if ( token->getImage() == "<-" ) {	return new LesserEqualsNode(); }
+		switch( token->getSubtype() ) {
+			case OP_GT:	return make<GreaterNode>();
+			case OP_LT:	return make<LesserNode>();
+			case OP_EQ:	return make<EqualsNode>();
+			case OP_NE:	return make<NotEqualsNode>();
+			case OP_GE:	return make<GreaterEqualsNode>();
+			case OP_LE:	return make<LesserEqualsNode>();
+			default:	break;
+		}
 		
 		// If nothing match, throw an error. Should not, since lexer should successfully
-		// parse the correct relational operator image to this token type
+		// set the correct relational operator subtype for this token type
 		previousToken();
-		throw error( "Relational operator token has incorrect image. Possible bug in the lexer.");
+		throw error( DG_INVALID_OPERATOR, EX_RELATIONAL_OP, token );
 	}
 
 
@@ -88,17 +386,20 @@ public:
 		// Check if the token is an additive operator.
 		if ( token->getType() != TK_ADD_OP ) {
 			previousToken();
-			throw error("an additive operator");
+			throw expected( EX_ADDITIVE_OP, token );
 		}
 		
-		if ( token->getImage() == "+" ) {	return new PlusNode(); }
-		if ( token->getImage() == "-" ) {	return new MinusNode(); }
-		if ( token->getImage() == "or" ) {	return new OrNode(); }
+		switch( token->getSubtype() ) {
+			case OP_PLUS:	return make<PlusNode>();
+			case OP_MINUS:	return make<MinusNode>();
+			case OP_OR:		return make<OrNode>();
+			default:		break;
+		}
 		
 		// If nothing match, throw an error. Should not, since lexer should successfully
-		// parse the correct additive operator image to this token type
+		// set the correct additive operator subtype for this token type
 		previousToken();
-		throw error( "Additive operator token has incorrect image. Possible bug in the lexer.");
+		throw error( DG_INVALID_OPERATOR, EX_ADDITIVE_OP, token );
 	}
 
 
@@ -113,17 +414,20 @@ public:
 		// Check if the token is an multiplicative operator.
 		if ( token->getType() != TK_MULT_OP ) {
 			previousToken();
-			throw error("an multiplicative operator");
+			throw expected( EX_MULTIPLICATIVE_OP, token );
 		}
 		
-		if ( token->getImage() == "*" ) {	return new MultiplyNode(); }
-		if ( token->getImage() == "/" ) {	return new DivideNode(); }
-		if ( token->getImage() == "and" ) {	return new AndNode(); }
+		switch( token->getSubtype() ) {
+			case OP_MULT:	return make<MultiplyNode>();
+			case OP_DIV:	return make<DivideNode>();
+			case OP_AND:	return make<AndNode>();
+			default:		break;
+		}
 		
 		// If nothing match, throw an error. Should not, since lexer should successfully
-		// parse the correct multiplicative operator image to this token type
+		// set the correct multiplicative operator subtype for this token type
 		previousToken();
-		throw error( "Multiplicative operator token has incorrect image. Possible bug in the lexer.");
+		throw error( DG_INVALID_OPERATOR, EX_MULTIPLICATIVE_OP, token );
 	}
 
 
@@ -135,16 +439,24 @@ public:
 	/**
 	 * <Identifier> ::= <TK_IDENTIFIER>
 	 */
-	ASTNode* parseIdentifier() {
+	ASTNode* parseIdentifierRule() {
 		Token* token = nextToken();
 
 		// If not an identifier, go back 1 token and throw an error
 		if ( token->getType() != TK_IDENTIFIER ) {
 			previousToken();
-			throw error( "Expected an identifier, found " + token->toString() );
+			throw expected( EX_IDENTIFIER, token );
 		}
 		// Return the node
-		return new IdentifierNode( token->getImage() );
+		return make<IdentifierNode>( lexer->getImageData(token), token->getLength(), token->getSymbol() );
+	}
+
+	// Parses a <Identifier>, remembering the result in packrat mode
+	ASTNode* parseIdentifier() {
+		if ( packrat ) {
+			return memoize(MEMO_IDENTIFIER, &Parser::parseIdentifierRule);
+		}
+		return parseIdentifierRule();
 	}
 
 
@@ -157,17 +469,23 @@ public:
 
 		// If a keyword
 		if ( token->getType() == TK_KEYWORD ) {
-			// Prepare known types
-			std::vector<string> types {"int", "real", "bool", "char", "string", "unit"};
 			// Check if token is a type keyword
-			if ( find( types.begin(), types.end(), token->getImage() ) != types.end() ) {
-				return new TypeNode( token->getImage() );
+			switch( token->getSubtype() ) {
+				case KW_INT:
+				case KW_REAL:
+				case KW_BOOL:
+				case KW_CHAR:
+				case KW_STRING:
+				case KW_UNIT:
+					return make<TypeNode>( lexer->getImageData(token), token->getLength() );
+				default:
+					break;
 			}
 		}
 
 		// Go back 1 token and throw error if not a type keyword
 		previousToken();
-		throw error( "Unknown type '" + token->getImage() + "', at " + token->getPosition() );
+		throw error( DG_UNKNOWN_TYPE, EX_TYPE, token );
 	}
 
 
@@ -180,32 +498,20 @@ public:
 	ASTNode* parseLiteral() {
 		Token* token = nextToken();
 
-		// Prepare the type and value
-		string value = token->getImage();
-
 		// Check the token type
-		if ( token->getType() == TK_INTEGER ) {
-			return new IntegerLiteralNode(value);
-		}
-		if ( token->getType() == TK_REAL ) {
-			return new RealLiteralNode(value);
-		}
-		if ( token->getType() == TK_BOOL ) {
-			return new BooleanLiteralNode(value);
-		}
-		if ( token->getType() == TK_CHAR ) {
-			return new CharLiteralNode(value);
-		}
-		if ( token->getType() == TK_STRING ) {
-			return new StringLiteralNode(value);
-		}
-		if ( token->getType() == TK_UNIT ) {
-			return new UnitLiteralNode(value);
+		switch( token->getType() ) {
+			case TK_INTEGER:	return make<IntegerLiteralNode>( lexer->getImageData(token), token->getLength(), lexer->getLiteral(token).integer );
+			case TK_REAL:		return make<RealLiteralNode>( lexer->getImageData(token), token->getLength(), lexer->getLiteral(token).real );
+			case TK_BOOL:		return make<BooleanLiteralNode>( lexer->getImageData(token), token->getLength() );
+			case TK_CHAR:		return make<CharLiteralNode>( lexer->getImageData(token), token->getLength(), lexer->getLiteral(token).character );
+			case TK_STRING:		return make<StringLiteralNode>( lexer->getImageData(token), token->getLength(), lexer->getLiteral(token).text, lexer->getLiteral(token).length );
+			case TK_UNIT:		return make<UnitLiteralNode>( lexer->getImageData(token), token->getLength() );
+			default:			break;
 		}
 		
 		// If no type was determined, throw an error
 		previousToken();
-		throw error( "Expected a valid type, found " + token->toString() );
+		throw expected( EX_LITERAL, token );
 	}
 
 
@@ -217,7 +523,7 @@ public:
 	 */
 	ASTNode* parseFormalParam() {
 		// Prepare the node
-		ParamNode* formalParamNode = new ParamNode();
+		ParamNode* formalParamNode = make<ParamNode>();
 
 		// Parse the identifier
 		formalParamNode->addChild( parseIdentifier() );
@@ -227,7 +533,7 @@ public:
 		// If not a colon, error
 		if ( token->getType() != TK_COLON ) {
 			previousToken();
-			throw error( "Expected a colon, found " + token->toString() );
+			throw expected( EX_COLON, token );
 		}
 
 		// Parse the type
@@ -243,7 +549,7 @@ public:
 	 * <FormalParams> ::= <FormalParam> { ',' <FormalParam> }
 	 */
 	ASTNode* parseFormalParams() {
-		ParamsNode* params = new ParamsNode();
+		ParamsNode* params = make<ParamsNode>();
 
 		// Parse the first param
 		params->addChild( parseFormalParam() );
@@ -267,13 +573,13 @@ public:
 	 */
 	ASTNode* parseFunctionDecl() {
 		// Prepare the node
-		FuncDeclNode* node = new FuncDeclNode();
+		FuncDeclNode* node = make<FuncDeclNode>();
 
 		// Check for 'function' keyword
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "function" ) {
+		if ( !token->is(TK_KEYWORD, KW_FUNCTION) ) {
 			previousToken();
-			throw error( "Expected a 'function' keyword, found " + token->toString() );
+			throw expected( EX_FUNCTION, token );
 		}
 
 		node->addChild( parseIdentifier() );
@@ -282,14 +588,20 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
 		// Parse the params (OPTIONAL)
-		ASTNode* params = new ParamsNode();
-		try {
-			params = parseFormalParams();
-		} catch( ParseException &e ) {}
+		ASTNode* params = make<ParamsNode>();
+		if ( predictive ) {
+			if ( peekToken()->getType() == TK_IDENTIFIER ) {
+				params = parseFormalParams();
+			}
+		} else {
+			try {
+				params = parseFormalParams();
+			} catch( ParseException &e ) {}
+		}
 		// Add Params
 		node->addChild( params );
 
@@ -297,25 +609,96 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Expected a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Check for <TK_COLON>
 		token = nextToken();
 		if ( token->getType() != TK_COLON ) {
 			previousToken();
-			throw error( "Expected a colon, found " + token->toString() );
+			throw expected( EX_COLON, token );
 		}
 
 		// Parse a type
 		node->addChild( parseType() );
 
 		// Parse  block
-		node->addChild( parseBlock() );
+		if ( lazy && !lexer->isStreaming() ) {
+			node->addChild( skipBlock() );
+			node->setBodyParsed(false);
+		} else {
+			node->addChild( parseBlock() );
+		}
+
+		return node;
+	}
+
+	/**
+	 * Skips a <Block> by brace matching, and returns an empty block node recording
+	 * its tokens.
+	 */
+	ASTNode* skipBlock() {
+		size_t start = lexer->getPosition();
+
+		// Check for '{'
+		Token* token = nextToken();
+		if ( token->getType() != TK_OPEN_BLOCK ) {
+			previousToken();
+			throw expected( EX_OPEN_BRACE, token );
+		}
+
+		// Skip to the matching '}'
+		int depth = 1;
+		while ( depth > 0 ) {
+			token = nextToken();
+			switch( token->getType() ) {
+				case TK_OPEN_BLOCK:		depth++;	break;
+				case TK_CLOSE_BLOCK:	depth--;	break;
+				case TK_EOF:
+					previousToken();
+					throw expected( EX_CLOSE_BRACE, token );
+				case TK_NONE:
+					throw expected( EX_CLOSE_BRACE, token );
+				default:				break;
+			}
+		}
 
+		ASTNode* node = make<BlockNode>();
+		node->setTokens( start, lexer->getPosition(), lexer->getPosition() );
 		return node;
 	}
 
+	/**
+	 * Returns the body of a function declaration, parsing it first if it was skipped
+	 * in lazy mode. Function declarations in the body are skipped in turn, in lazy
+	 * mode. Throws a ParseException if the body has a syntax error.
+	 */
+	ASTNode* parseBody(FuncDeclNode* node) {
+		size_t last = node->getChildCount() - 1;
+		if ( node->isBodyParsed() ) {
+			return node->getChild(last);
+		}
+
+		// Parse the block at the tokens it was skipped from
+		size_t saved = lexer->getPosition();
+		lexer->setPosition( node->getChild(last)->getTokenBegin() );
+		memo.clear();
+		ASTNode* body;
+		try {
+			body = parseBlock();
+		} catch( ParseException &e ) {
+			memo.clear();
+			lexer->setPosition(saved);
+			throw;
+		}
+		memo.clear();
+		lexer->setPosition(saved);
+
+		node->setChild(last, body);
+		node->setBodyParsed(true);
+		return body;
+	}
+
 
 
 
@@ -327,7 +710,7 @@ public:
 	 */
 	ASTNode* parseActualParams() {
 		// Prepare the node
-		ASTNode* node = new FuncParamsNode();
+		ASTNode* node = make<FuncParamsNode>();
 
 		// Parse an expression
 		node->addChild( parseExpression() );
@@ -351,7 +734,7 @@ public:
 	 */
 	ASTNode* parseFunctionCall() {
 		// Prepare the node
-		ASTNode* node = new FuncCallNode();
+		ASTNode* node = make<FuncCallNode>();
 
 		// Parse the identifier (function name)
 		node->addChild( parseIdentifier() );
@@ -360,17 +743,21 @@ public:
 		Token* token = nextToken();
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
-		// Parse the params
-		node->addChild( parseActualParams() );
+		// Parse the params (OPTIONAL)
+		if ( peekToken()->getType() == TK_CLOSE_PAREN ) {
+			node->addChild( make<FuncParamsNode>() );
+		} else {
+			node->addChild( parseActualParams() );
+		}
 
 		// Check for a closing parenthises
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Exptecred a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Return the node
@@ -389,16 +776,16 @@ public:
 		// If the token is not a additive operator or a keyword, throw an error
 		if ( token->getType() != TK_ADD_OP && token->getType() != TK_KEYWORD ) {
 			previousToken();
-			throw error( "Expected an additive operator or a 'not', found " + token->toString() );
+			throw expected( EX_ADDITIVE_OP | EX_NOT, token );
 		}
 		// If the additive operator or the keyword is not a "+", "-" or "not", throw an error
-		if ( token->getImage() != "+" && token->getImage() != "-" && token->getImage() != "not" ) {
+		if ( token->getSubtype() != OP_PLUS && token->getSubtype() != OP_MINUS && token->getSubtype() != KW_NOT ) {
 			previousToken();
-			throw error( "Invalid unary operator " + token->toString() );
+			throw error( DG_INVALID_UNARY_OPERATOR, EX_ADDITIVE_OP | EX_NOT, token );
 		}
 
 		// Return the node
-		return new UnaryOpNode( token->getImage() );
+		return make<UnaryOpNode>( lexer->getImageData(token), token->getLength() );
 	}
 
 
@@ -407,7 +794,7 @@ public:
 	 */
 	ASTNode* parseUnary() {
 		// Prepare the node
-		ASTNode* node = new UnaryNode();
+		ASTNode* node = make<UnaryNode>();
 		// Parse the unary operator
 		node->addChild( parseUnaryOperator() );
 		// Parse expression
@@ -424,13 +811,13 @@ public:
 	 */
 	ASTNode* parseTypeCast() {
 		// Prepare the node
-		ASTNode* node = new TypeCastNode();
+		ASTNode* node = make<TypeCastNode>();
 
 		// Check for an opening parenthesis
 		Token* token = nextToken();
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
 		// Parse a type
@@ -446,7 +833,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Expected a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Parse an expression
@@ -466,7 +853,10 @@ public:
 	/**
 	 * <Factor> ::= <Literal> | <Identifier> | <FunctionCall> | <TypeCast> | <SubExpression> | <Unary>
 	 */
-	ASTNode* parseFactor() {
+	ASTNode* parseFactorRule() {
+		if ( predictive ) {
+			return predictFactor();
+		}
 
 		// Try parsing a literal
 		try {
@@ -499,19 +889,62 @@ public:
 		} catch( ParseException &e ) {}
 
 		// Throw an error if non of the above returned a node
-		throw error( "Expected a valid expression factor, found " + lexer->getToken()->toString() );
+		throw expected( EX_FACTOR, lexer->getToken() );
+	}
+
+	// Parses a <Factor>, remembering the result in packrat mode
+	ASTNode* parseFactor() {
+		if ( packrat ) {
+			return memoize(MEMO_FACTOR, &Parser::parseFactorRule);
+		}
+		return parseFactorRule();
+	}
+
+	/**
+	 * Parses a factor, choosing the production from the next two tokens.
+	 */
+	ASTNode* predictFactor() {
+		Token* token = peekToken();
+
+		if ( isLiteral(token) ) {
+			return parseLiteral();
+		}
+		// An identifier followed by '(' is a function call
+		if ( token->getType() == TK_IDENTIFIER ) {
+			if ( peekToken(1)->getType() == TK_OPEN_PAREN ) {
+				return parseFunctionCall();
+			}
+			return parseIdentifier();
+		}
+		// A '(' followed by a type is a type cast
+		if ( token->getType() == TK_OPEN_PAREN ) {
+			if ( isType( peekToken(1) ) ) {
+				return parseTypeCast();
+			}
+			return parseSubExpression();
+		}
+		if ( isUnaryOp(token) ) {
+			return parseUnary();
+		}
+
+		throw expected( EX_FACTOR, token );
 	}
 
 
 	/**
 	 * <Term> ::= <Factor> { <MultOp> <Factor> }
 	 */
-	ASTNode* parseTerm() {
+	ASTNode* parseTermRule() {
 		out("Parsing Term");
 
 		// Parse a factor
 		ASTNode* fact1 = parseFactor();
 
+		// Without a mult operator after the first factor, return the first factor
+		if ( predictive && peekToken()->getType() != TK_MULT_OP ) {
+			return fact1;
+		}
+
 		try {
 			// Parse the mult op
 			ASTNode* opNode = parseMultOp();
@@ -524,22 +957,39 @@ public:
 			return opNode;
 		}
 		catch( ParseException &e ){
+			// In predictive mode, the operator was there: this is a syntax error
+			if ( predictive ) {
+				throw;
+			}
 			// If no mult operator is present after the first factor,
 			// Return the first factor
 			return fact1;
 		}
 	}
 
+	// Parses a <Term>, remembering the result in packrat mode
+	ASTNode* parseTerm() {
+		if ( packrat ) {
+			return memoize(MEMO_TERM, &Parser::parseTermRule);
+		}
+		return parseTermRule();
+	}
+
 
 	/**
 	 * <SimpleExpression> ::= <Term> { <AddOp> <Term> }
 	 */
-	ASTNode* parseSimpleExpression() {
+	ASTNode* parseSimpleExpressionRule() {
 		out("Parsing Simple Expression");
 
 		// Parse a term
 		ASTNode* term1 = parseTerm();
 
+		// Without an additive operator after the first term, return the term
+		if ( predictive && peekToken()->getType() != TK_ADD_OP ) {
+			return term1;
+		}
+
 		try {
 			// Parse the additive op
 			ASTNode* opNode = parseAddOp();
@@ -552,24 +1002,49 @@ public:
 			return opNode;
 		}
 		catch( ParseException &e ){
+			// In predictive mode, the operator was there: this is a syntax error
+			if ( predictive ) {
+				throw;
+			}
 			// If no additive operator is present after the first term,
 			// Return the term
 			return term1;
 		}
 	}
 
+	// Parses a <SimpleExpression>, remembering the result in packrat mode
+	ASTNode* parseSimpleExpression() {
+		if ( packrat ) {
+			return memoize(MEMO_SIMPLE_EXPRESSION, &Parser::parseSimpleExpressionRule);
+		}
+		return parseSimpleExpressionRule();
+	}
+
 
 	/**
 	 * <Expression> ::= <SimpleExpression> { <RelOp> <SimpleExpression> }
 	 */
-	ASTNode* parseExpression() {
+	ASTNode* parseExpressionRule() {
 		out("Parsing Expression");
 
 		// Prepare the node
-		ASTNode* node = new ExprNode();
+		ASTNode* node = make<ExprNode>();
+
+		if ( precedenceClimbing ) {
+			node->addChild( parseOperators(1) );
+			return node;
+		}
+
 		// Parse the first simple expression
 		ASTNode* expr1 = parseSimpleExpression();
 
+		// Without a relational operator after the first simple expression, the
+		// expression is the simple expression
+		if ( predictive && peekToken()->getType() != TK_REL_OP ) {
+			node->addChild( expr1 );
+			return node;
+		}
+
 		try {
 			// Parse the relational op
 			ASTNode* opNode = parseRelOp();
@@ -582,6 +1057,10 @@ public:
 			node->addChild( opNode );
 		}
 		catch( ParseException &e ){
+			// In predictive mode, the operator was there: this is a syntax error
+			if ( predictive ) {
+				throw;
+			}
 			// Ignore no relational operator is present after the first
 			// simple expression
 			node->addChild( expr1 );
@@ -591,6 +1070,45 @@ public:
 		return node;
 	}
 
+	// Parses a <Expression>, remembering the result in packrat mode
+	ASTNode* parseExpression() {
+		if ( packrat ) {
+			return memoize(MEMO_EXPRESSION, &Parser::parseExpressionRule);
+		}
+		return parseExpressionRule();
+	}
+
+
+	/**
+	 * Parses factors joined by binary operators of the given precedence or higher.
+	 * Operators of the same precedence are consumed in a loop, each one taking the
+	 * node built so far as its left operand. Only a higher precedence operator on the
+	 * right recurses, so the depth is bounded by the number of precedence levels.
+	 */
+	ASTNode* parseOperators(int minPrecedence) {
+		// Parse the left operand
+		ASTNode* left = parseFactor();
+
+		int prec;
+		while ( ( prec = precedence( peekToken() ) ) >= minPrecedence ) {
+			// Parse the operator
+			ASTNode* opNode;
+			switch( prec ) {
+				case 1:		opNode = parseRelOp();	break;
+				case 2:		opNode = parseAddOp();	break;
+				default:	opNode = parseMultOp();	break;
+			}
+			// Parse the right operand: the factors joined by higher precedence operators
+			ASTNode* right = parseOperators( prec + 1 );
+			// The operator node becomes the left operand of the next operator
+			opNode->addChild( left );
+			opNode->addChild( right );
+			left = opNode;
+		}
+
+		return left;
+	}
+
 
 	/**
 	 * <SubExpression> ::= '(' <Expression> ')'
@@ -603,7 +1121,7 @@ public:
 		// Check for opening parenthesis
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
 		// Attempt to parse as expression
@@ -613,7 +1131,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Expected a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Return the node
@@ -629,13 +1147,13 @@ public:
 		out("Parsing Assignment statement");
 
 		// Prepare node
-		ASTNode* node = new AssignNode();
+		ASTNode* node = make<AssignNode>();
 
 		// Check for "set"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "set" ) {
+		if ( !token->is(TK_KEYWORD, KW_SET) ) {
 			previousToken();
-			throw error( "Expected 'set' keyword, found " + token->toString() );
+			throw expected( EX_SET, token );
 		}
 
 		// Parse identifier
@@ -645,7 +1163,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_ASSIGN_OP ) {
 			previousToken();
-			throw error( "Expected '<-' operator, found " + token->toString() );
+			throw expected( EX_ASSIGN_OP, token );
 		}
 
 		// Parse Expression
@@ -655,7 +1173,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_SEMICOLON ) {
 			previousToken();
-			throw error( "Expected semicolon ';', found " + token->toString() );
+			throw expected( EX_SEMICOLON, token );
 		}
 
 		return node;
@@ -671,13 +1189,13 @@ public:
 		out("Parsing Assignment statement");
 
 		// Prepare the node
-		ASTNode* node = new VariableDeclNode();
+		ASTNode* node = make<VariableDeclNode>();
 
 		// Check for "let"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "let" ) {
+		if ( !token->is(TK_KEYWORD, KW_LET) ) {
 			previousToken();
-			throw error( "Expected 'let' keyword, found " + token->toString() );
+			throw expected( EX_LET, token );
 		}
 
 		// Parse Identifier
@@ -687,7 +1205,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_COLON ) {
 			previousToken();
-			throw error( "Expected ':', found " + token->toString() );
+			throw expected( EX_COLON, token );
 		}
 
 		// Parse type
@@ -697,7 +1215,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_EQUALS_OP ) {
 			previousToken();
-			throw error( "Expected '=', found " + token->toString() );
+			throw expected( EX_EQUALS, token );
 		}
 
 		// Parse Expression
@@ -707,13 +1225,13 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_SEMICOLON ) {
 			// Check for 'in' keyword
-			if ( token->getType() == TK_KEYWORD && token->getImage() == "in" ) {
+			if ( token->is(TK_KEYWORD, KW_IN) ) {
 				node->addChild( parseBlock() );
 			}
 			// If not ';' or 'in', error
 			else {
 				previousToken();
-				throw error( "Expected semicolon ';', found " + token->toString() );
+				throw expected( EX_SEMICOLON, token );
 			}
 		}
 
@@ -731,20 +1249,20 @@ public:
 		out("Parsing If Statement");
 
 		// Prepare node
-		ASTNode* node = new IfNode();
+		ASTNode* node = make<IfNode>();
 
 		// Check for "if"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "if" ) {
+		if ( !token->is(TK_KEYWORD, KW_IF) ) {
 			previousToken();
-			throw error( "Expected 'if' keyword, found " + token->toString() );
+			throw expected( EX_IF, token );
 		}
 
 		// Check for '('
 		token = nextToken();
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
 		// Parse expression
@@ -754,7 +1272,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Expected a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Parse statement
@@ -762,7 +1280,7 @@ public:
 
 		// Check for 'else'
 		token = nextToken();
-		if ( token->getType() == TK_KEYWORD && token->getImage() == "else" ) {
+		if ( token->getType() == TK_KEYWORD && lexer->getImage(token) == "else" ) {
 			node->addChild( parseStatement() );
 		} else {
 			previousToken();
@@ -781,20 +1299,20 @@ public:
 		out("Parsing while statement");
 
 		// Prepare the node
-		ASTNode* node = new WhileNode();
+		ASTNode* node = make<WhileNode>();
 
 		// Check for "while"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "while" ) {
+		if ( !token->is(TK_KEYWORD, KW_WHILE) ) {
 			previousToken();
-			throw error( "Expected 'while' keyword, found " + token->toString() );
+			throw expected( EX_WHILE, token );
 		}
 
 		// Check for '('
 		token = nextToken();
 		if ( token->getType() != TK_OPEN_PAREN ) {
 			previousToken();
-			throw error( "Expected an opening parenthesis, found " + token->toString() );
+			throw expected( EX_OPEN_PAREN, token );
 		}
 
 		// Parse expression
@@ -804,7 +1322,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_PAREN ) {
 			previousToken();
-			throw error( "Expected a closing parenthesis, found " + token->toString() );
+			throw expected( EX_CLOSE_PAREN, token );
 		}
 
 		// Parse statement
@@ -816,33 +1334,35 @@ public:
 
 
 
+	// Parses a <Block>, recording its tokens
 	ASTNode* parseBlock() {
+		return parseRanged(&Parser::parseBlockRule);
+	}
+
+	/**
+	 * <Block> ::= '{' { <Statement> } '}'
+	 */
+	ASTNode* parseBlockRule() {
 		out("Parsing block");
 
 		// Prepare node
-		ASTNode* node = new BlockNode();
+		ASTNode* node = make<BlockNode>();
 
 		// Check for '{'
 		Token* token = nextToken();
 		if ( token->getType() != TK_OPEN_BLOCK ) {
 			previousToken();
-			throw error( "Expected an opening brace, found " + token->toString() );
+			throw expected( EX_OPEN_BRACE, token );
 		}
 
-		// Parse statements, until statements do not match
-		do {
-			try {
-				node->addChild( parseStatement() );
-			} catch ( ParseException &e ) {
-				break;
-			}
-		} while( 1 == 1 );
+		// Parse statements, until they end
+		while ( parseBlockStatement(node) ) {}
 
 		// Check for '}'
 		token = nextToken();
 		if ( token->getType() != TK_CLOSE_BLOCK ) {
 			previousToken();
-			throw error( "Expected a closing brace, found " + token->toString() );
+			throw expected( EX_CLOSE_BRACE, token );
 		}
 
 		// Return node
@@ -850,6 +1370,29 @@ public:
 	}
 
 
+	/**
+	 * Parses the next statement of a block into the node. Returns false if the
+	 * statements of the block ended.
+	 */
+	bool parseBlockStatement(ASTNode* node) {
+		if ( predictive ) {
+			// Statements end when the next token cannot start one
+			if ( !startsStatement( peekToken() ) ) {
+				return false;
+			}
+			node->addChild( parseStatement() );
+			return true;
+		}
+		// Statements end when they do not match
+		try {
+			node->addChild( parseStatement() );
+		} catch ( ParseException &e ) {
+			return false;
+		}
+		return true;
+	}
+
+
 	/**
 	 * <Statement> ::=	  <FunctionDecl>
 	 *					| <Assignment>
@@ -862,9 +1405,13 @@ public:
 	 *					| <HaltStatement>
 	 *					| <Block>
 	 */
-	ASTNode* parseStatement() {
+	ASTNode* parseStatementRule() {
 		out("Parsing Statement");
-		
+
+		if ( predictive ) {
+			return predictStatement();
+		}
+
 		// Try parsing a function declaration
 		try {
 			return parseFunctionDecl();
@@ -923,7 +1470,56 @@ public:
 		} catch( ParseException &e ) {}
 
 		// Throw an error if non of the above returned a node
-		throw error( "Expected a statement, found " + lexer->getToken()->toString() );
+		throw expected( EX_STATEMENT, lexer->getToken() );
+	}
+
+	// Parses a <Statement>, recording its tokens
+	ASTNode* parseStatement() {
+		return parseRanged(&Parser::parseStatementMemo);
+	}
+	// Parses a <Statement>, remembering the result in packrat mode
+	ASTNode* parseStatementMemo() {
+		if ( packrat ) {
+			return memoize(MEMO_STATEMENT, &Parser::parseStatementRule);
+		}
+		return parseStatementRule();
+	}
+
+	/**
+	 * Parses a statement, choosing the production from the next token.
+	 */
+	ASTNode* predictStatement() {
+		Token* token = peekToken();
+
+		if ( token->getType() == TK_KEYWORD ) {
+			switch( token->getSubtype() ) {
+				case KW_FUNCTION:	return parseFunctionDecl();
+				case KW_SET:		return parseAssignStatement();
+				case KW_LET:		return parseVariableDecl();
+				case KW_READ:		return parseReadStatement();
+				case KW_WRITE:		return parseWriteStatement();
+				case KW_IF:			return parseIfStatement();
+				case KW_WHILE:		return parseWhileStatement();
+				case KW_HALT:		return parseHaltStatement();
+				default:			break;
+			}
+		}
+		if ( token->getType() == TK_OPEN_BLOCK ) {
+			return parseBlock();
+		}
+
+		// Parse an expression statement, followed by a ';'
+		if ( startsExpression(token) ) {
+			ASTNode* expr = parseExpression();
+			token = nextToken();
+			if ( token->getType() != TK_SEMICOLON ) {
+				previousToken();
+				throw expected( EX_SEMICOLON, token );
+			}
+			return expr;
+		}
+
+		throw expected( EX_STATEMENT, token );
 	}
 
 
@@ -936,13 +1532,13 @@ public:
 		out("Parsing Read statement");
 
 		// Prepare the node
-		ASTNode* node = new ReadNode();
+		ASTNode* node = make<ReadNode>();
 
 		// Check for "read"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "read" ) {
+		if ( !token->is(TK_KEYWORD, KW_READ) ) {
 			previousToken();
-			throw error( "Expected 'read' keyword, found " + token->toString() );
+			throw expected( EX_READ, token );
 		}
 
 		// Parse Identifier
@@ -952,7 +1548,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_SEMICOLON ) {
 			previousToken();
-			throw error( "Expected semicolon ';', found " + token->toString() );
+			throw expected( EX_SEMICOLON, token );
 		}
 
 		// Return node
@@ -967,13 +1563,13 @@ public:
 		out("Parsing Write statement");
 
 		// Prepare the node
-		ASTNode* node = new WriteNode();
+		ASTNode* node = make<WriteNode>();
 
 		// Check for "write"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "write" ) {
+		if ( !token->is(TK_KEYWORD, KW_WRITE) ) {
 			previousToken();
-			throw error( "Expected 'write' keyword, found " + token->toString() );
+			throw expected( EX_WRITE, token );
 		}
 
 		// Parse Identifier
@@ -983,7 +1579,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_SEMICOLON ) {
 			previousToken();
-			throw error( "Expected semicolon ';', found " + token->toString() );
+			throw expected( EX_SEMICOLON, token );
 		}
 
 		// Return node
@@ -999,20 +1595,20 @@ public:
 		out("Parsing halt statement");
 
 		// Prepare the node
-		ASTNode* node = new HaltNode();
+		ASTNode* node = make<HaltNode>();
 
 		// Check for "halt"
 		Token* token = nextToken();
-		if ( token->getType() != TK_KEYWORD || token->getImage() != "halt" ) {
+		if ( !token->is(TK_KEYWORD, KW_HALT) ) {
 			previousToken();
-			throw error( "Expected 'halt' keyword, found " + token->toString() );
+			throw expected( EX_HALT, token );
 		}
 
 		// Parse Identifier
 		// Check for ';'
 		token = nextToken();
 		if ( token->getType() == TK_INTEGER ) {
-			node->addChild( new IntegerLiteralNode( token->getImage() ) );
+			node->addChild( make<IntegerLiteralNode>( lexer->getImageData(token), token->getLength(), lexer->getLiteral(token).integer ) );
 		}
 		else {
 			previousToken();
@@ -1020,7 +1616,7 @@ public:
 				node->addChild( parseIdentifier() );
 			} catch( ParseException &e ) {
 				previousToken();
-				throw error( "Invalid exit code. Expected an integer literal or variable, found " + token->toString() );
+				throw error( DG_INVALID_EXIT_CODE, EX_IDENTIFIER | EX_INTEGER, token, lexer->getPosition() + 1 );
 			}
 		}
 
@@ -1028,7 +1624,7 @@ public:
 		token = nextToken();
 		if ( token->getType() != TK_SEMICOLON ) {
 			previousToken();
-			throw error( "Expected semicolon ';', found " + token->toString() );
+			throw expected( EX_SEMICOLON, token );
 		}
 
 		// Return node
@@ -1037,6 +1633,30 @@ public:
 
 
 
+	/**
+	 * Parses a top level <Statement>.
+	 */
+	ASTNode* parseTopLevelStatement() {
+		// Keep the tokens of the statement until it is parsed. When streaming, the
+		// lexer can then drop them, and memory stays bounded by the size of a single
+		// top-level statement.
+		size_t start = lexer->mark();
+		ASTNode* node;
+		try {
+			node = parseStatement();
+		} catch( ParseException &e ) {
+			lexer->release(start);
+			memo.clear();
+			throw;
+		}
+		lexer->release(start);
+		// Later statements never go back to the positions of this one
+		memo.clear();
+		return node;
+	}
+
+
+
 	/**
 	 * <Sxl> ::= { <Statement> }
 	 */
@@ -1044,21 +1664,395 @@ public:
 		out("Begin parsing SXL");
 
 		// Prepare the node
-		ASTNode* node = new SXLNode();
+		ASTNode* node = make<SXLNode>();
+		size_t start = lexer->getPosition();
 
 		Token* token;
 		// Loop if next token is not EOF
 		while ( ( token = nextToken() )->getType() != TK_EOF ) {
 			// Token is not EOF - move back to allow parseStatement to process it
 			previousToken();
-			node->addChild( parseStatement() );
+			node->addChild( parseTopLevelStatement() );
 		}
+		node->setTokens( start, lexer->getPosition(), lexer->getPosition() );
 
 		// Return the node
 		return node;
 	}
 
 
+
+	/**
+	 * Parses a program as parseSXL() does, but instead of throwing the first syntax
+	 * error, adds every error to the given collector, and goes on.
+	 *
+	 * After an error, tokens are skipped up to and including the next ';' or '}' at
+	 * the depth of the error (panic mode), and parsing goes on with a top level
+	 * statement. The statements after an error in a block are thus parsed as top
+	 * level statements, and the braces left open by the statement with the error are
+	 * matched by the '}' that close them. Returns the statements without errors.
+	 */
+	ASTNode* parseSXL(DiagnosticCollector& diagnostics) {
+		out("Begin parsing SXL, collecting errors");
+
+		ASTNode* node = make<SXLNode>();
+		size_t start = lexer->getPosition();
+		// Braces opened by statements cut short by an error, and not yet closed
+		size_t open = 0;
+
+		Token* token;
+		while ( ( token = peekToken() )->getType() != TK_EOF ) {
+			// Lexing stopped on an error: there are no more tokens
+			if ( token->isNullToken() ) {
+				diagnostics.add( expected(EX_STATEMENT, token) );
+				break;
+			}
+			if ( open > 0 && token->getType() == TK_CLOSE_BLOCK ) {
+				nextToken();
+				open--;
+				continue;
+			}
+			// Keep the tokens of the statement, to count its braces after an error
+			size_t begin = lexer->mark();
+			try {
+				ASTNode* statement = parseTopLevelStatement();
+				if ( open == 0 ) {
+					node->addChild(statement);
+				}
+			} catch( ParseException &e ) {
+				diagnostics.add(e);
+				open += recover( begin, e.getDiagnostic().getTokenIndex() );
+			}
+			lexer->release(begin);
+		}
+		node->setTokens( start, lexer->getPosition(), lexer->getPosition() );
+		return node;
+	}
+
+	/**
+	 * Skips the tokens of a statement starting at the given position, after an error
+	 * at the given token: up to and including the next ';' or '}' at the depth of the
+	 * error. Returns the number of braces the statement leaves open.
+	 */
+	size_t recover(size_t begin, size_t index) {
+		// Depth of the error in the statement
+		size_t depth = 0;
+		size_t i = begin;
+		for ( ; i < index; i++ ) {
+			Token* token = lexer->tokenAt(i);
+			if ( token == NULL ) break;
+			if ( token->getType() == TK_OPEN_BLOCK ) {
+				depth++;
+			} else if ( token->getType() == TK_CLOSE_BLOCK && depth > 0 ) {
+				depth--;
+			}
+		}
+		// Skip to the next ';' or '}'
+		for ( ; ; i++ ) {
+			Token* token = lexer->tokenAt(i);
+			if ( token == NULL || token->getType() == TK_EOF ) {
+				break;
+			}
+			if ( token->getType() == TK_OPEN_BLOCK ) {
+				depth++;
+			} else if ( token->getType() == TK_CLOSE_BLOCK ) {
+				i++;
+				if ( depth > 0 ) depth--;
+				break;
+			} else if ( token->getType() == TK_SEMICOLON ) {
+				i++;
+				break;
+			}
+		}
+		lexer->setPosition(i);
+		return depth;
+	}
+
+
+
+	/**
+	 * Updates a tree built by parseSXL(), after an edit of the tokens it was parsed
+	 * from. The lexer must hold the edited tokens (see setLexer()).
+	 *
+	 * Statements and blocks record the tokens they were parsed from, and those they
+	 * looked at after them. The statements that did not look at the edited tokens are
+	 * reused: those before the edit as they are, and those after it with their tokens
+	 * shifted. If the edit is inside a single block, only the statements of that block
+	 * are parsed again, and the nodes holding the block are copied, sharing their
+	 * other children. Otherwise, statements are parsed from the first one affected
+	 * until the parser is back at the start of an old statement after the edit.
+	 *
+	 * Returns the updated tree, which shares the unchanged subtrees of the old one.
+	 * The old tree must no longer be used, since the tokens of the shared nodes now
+	 * refer to the edited tokens. Throws a ParseException as parseSXL() would.
+	 */
+	ASTNode* reparse(ASTNode* tree, const TokenEdit& edit) {
+		out("Begin reparsing SXL");
+		memo.clear();
+
+		if ( !tree->hasTokens() ) {
+			lexer->setPosition(0);
+			return parseSXL();
+		}
+
+		ASTNode* node = make<SXLNode>();
+		shifted.clear();
+		reparseStatements(tree, edit, tree->getTokenBegin(), node, true);
+
+		// Check for EOF
+		Token* token = nextToken();
+		if ( token->getType() != TK_EOF ) {
+			previousToken();
+			throw expected( EX_STATEMENT, token );
+		}
+		node->setTokens( tree->getTokenBegin(), lexer->getPosition(), lexer->getPosition() );
+
+		// Shift the reused nodes after the edit
+		ptrdiff_t delta = (ptrdiff_t) edit.inserted - (ptrdiff_t) edit.removed;
+		for ( size_t i = 0; i < shifted.size(); i++ ) {
+			shifted[i]->shiftTokens(delta);
+		}
+		shifted.clear();
+		return node;
+	}
+
+	/**
+	 * Updates the statements of the old SXL or block node into the new node, and
+	 * leaves the lexer after them. The statements start at the given position.
+	 */
+	void reparseStatements(ASTNode* old, const TokenEdit& edit, size_t begin, ASTNode* node, bool topLevel) {
+		size_t after = edit.first + edit.removed;
+		ptrdiff_t delta = (ptrdiff_t) edit.inserted - (ptrdiff_t) edit.removed;
+		size_t count = old->getChildCount();
+
+		// Reuse the statements before the edit
+		size_t i = 0;
+		while ( i < count && old->getChild(i)->getTokenReach() <= edit.first ) {
+			node->addChild( old->getChild(i) );
+			i++;
+		}
+		size_t position = ( i > 0 )? old->getChild(i - 1)->getTokenEnd() : begin;
+
+		// If the edit is inside the next statement, update that statement alone
+		if ( i < count ) {
+			ASTNode* child = old->getChild(i);
+			ASTNode* updated = NULL;
+			if ( child->getTokenBegin() < edit.first && after < child->getTokenEnd() ) {
+				updated = reparseNode(child, edit);
+			}
+			if ( updated != NULL ) {
+				node->addChild(updated);
+				for ( i++; i < count; i++ ) {
+					shifted.push_back( old->getChild(i) );
+					node->addChild( old->getChild(i) );
+				}
+				lexer->setPosition( old->getChild(count - 1)->getTokenEnd() + delta );
+				return;
+			}
+		}
+
+		// Parse statements from the first one affected, until back at an old one
+		lexer->setPosition(position);
+		size_t j = i;
+		while ( true ) {
+			size_t p = lexer->getPosition();
+			while ( j < count && ( old->getChild(j)->getTokenBegin() < after || old->getChild(j)->getTokenBegin() + delta < p ) ) {
+				j++;
+			}
+			if ( j < count && old->getChild(j)->getTokenBegin() + delta == p ) {
+				// Back in step: reuse the rest
+				for ( ; j < count; j++ ) {
+					shifted.push_back( old->getChild(j) );
+					node->addChild( old->getChild(j) );
+				}
+				lexer->setPosition( old->getChild(count - 1)->getTokenEnd() + delta );
+				return;
+			}
+
+			if ( topLevel ) {
+				if ( peekToken()->getType() == TK_EOF ) {
+					return;
+				}
+				node->addChild( parseTopLevelStatement() );
+			} else if ( !parseBlockStatement(node) ) {
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Updates a statement or block holding the whole edit, except for its first and
+	 * last tokens, by updating the block or statement in it that holds the edit.
+	 * Returns NULL if the node must be parsed again as a whole.
+	 */
+	ASTNode* reparseNode(ASTNode* old, const TokenEdit& edit) {
+		size_t after = edit.first + edit.removed;
+		ptrdiff_t delta = (ptrdiff_t) edit.inserted - (ptrdiff_t) edit.removed;
+		size_t end = old->getTokenEnd() + delta;
+		size_t until = ( old->getTokenReach() != SIZE_MAX )? old->getTokenReach() + delta : SIZE_MAX;
+
+		if ( old->getKind() == NK_BLOCK ) {
+			// Update the statements between the braces. Errors are left to parsing the
+			// whole node again, so that they are the same as with parseSXL().
+			size_t mark = shifted.size();
+			ASTNode* node = make<BlockNode>();
+			try {
+				reparseStatements(old, edit, old->getTokenBegin() + 1, node, false);
+			} catch( ParseException &e ) {
+				shifted.resize(mark);
+				return NULL;
+			}
+			// The block must still end at its old '}'
+			if ( lexer->getPosition() != end - 1 || peekToken()->getType() != TK_CLOSE_BLOCK ) {
+				shifted.resize(mark);
+				return NULL;
+			}
+			nextToken();
+			node->setTokens( old->getTokenBegin(), end, until );
+			return node;
+		}
+
+		// Update the statement or block holding the edit
+		for ( size_t i = 0; i < old->getChildCount(); i++ ) {
+			ASTNode* child = old->getChild(i);
+			if ( !child->hasTokens() || child->getTokenEnd() <= edit.first ) {
+				continue;
+			}
+			if ( child->getTokenBegin() >= edit.first || after >= child->getTokenEnd() ) {
+				return NULL;
+			}
+			ASTNode* updated = reparseNode(child, edit);
+			if ( updated == NULL ) {
+				return NULL;
+			}
+			// Copy the node, with the updated child
+			ASTNode* node = copyNode(old);
+			node->setChild(i, updated);
+			if ( node->getKind() == NK_FUNC_DECL && updated->getKind() == NK_BLOCK ) {
+				static_cast<FuncDeclNode*>(node)->setBodyParsed(true);
+			}
+			for ( i++; i < old->getChildCount(); i++ ) {
+				if ( old->getChild(i)->hasTokens() ) {
+					shifted.push_back( old->getChild(i) );
+				}
+			}
+			node->setTokens( old->getTokenBegin(), end, until );
+			return node;
+		}
+		return NULL;
+	}
+
+	/**
+	 * Returns a copy of the given node, with its own array of the same children.
+	 */
+	ASTNode* copyNode(ASTNode* node) {
+		ASTNode* copy;
+		switch( node->getKind() ) {
+			#define X(Name, Class, Kind) \
+				case Kind: copy = arena->make<Class>( *static_cast<Class*>(node) ); break;
+			AST_NODE_CLASSES(X)
+			#undef X
+			default: return NULL;
+		}
+		copy->copyChildren();
+		return copy;
+	}
+
+
+
+	/**
+	 * Parses an <Sxl> into a flat AST.
+	 * Each top level statement is parsed as a tree in a scratch arena, copied into the
+	 * flat AST, and dropped. The whole program is never held as a tree, so memory is
+	 * that of the flat AST plus the largest statement.
+	 */
+	FlatAST* parseFlat() {
+		out("Begin parsing SXL");
+
+		FlatAST* flat = new FlatAST();
+		vector<uint32_t> statements;
+		// There are about as many nodes as tokens
+		if ( !lexer->isStreaming() ) {
+			flat->reserve( lexer->getTokens().size() );
+		}
+
+		// Allocate the statement trees in a scratch arena. Function bodies cannot be
+		// parsed later from there, so they are parsed now.
+		Arena scratch;
+		Arena* saved = arena;
+		arena = &scratch;
+		bool savedLazy = lazy;
+		lazy = false;
+
+		try {
+			Token* token;
+			// Loop if next token is not EOF
+			while ( ( token = nextToken() )->getType() != TK_EOF ) {
+				previousToken();
+				ASTNode* statement = parseTopLevelStatement();
+
+				statements.push_back( flat->addTree(statement) );
+				scratch.reset();
+			}
+		} catch( ParseException &e ) {
+			arena = saved;
+			lazy = savedLazy;
+			delete flat;
+			throw;
+		}
+		arena = saved;
+		lazy = savedLazy;
+
+		// Add the root node, after all the statements
+		uint32_t root = flat->add(NK_SXL);
+		flat->setChildren( root, statements.data(), statements.size() );
+		flat->setRoot(root);
+		return flat;
+	}
+
+
+
+	/**
+	 * Parses an <Sxl>, sending its structure to the given listener as events (see
+	 * ParseListener), without building a tree of the program.
+	 * Each top level statement is parsed as a tree in a scratch arena, since rules
+	 * backtrack and operators come before their operands, then walked and dropped.
+	 * Memory is then that of the largest statement, and with a streaming lexer, does
+	 * not grow with the program. If a statement has a syntax error, the events of the
+	 * statements before it have been sent when the ParseException is thrown.
+	 */
+	template<class Listener>
+	void parseEvents(Listener& listener) {
+		out("Begin parsing SXL");
+
+		ParseEventEmitter<Listener> emitter(&listener);
+		// Allocate the statement trees in a scratch arena, and parse bodies now
+		Arena scratch;
+		Arena* saved = arena;
+		arena = &scratch;
+		bool savedLazy = lazy;
+		lazy = false;
+
+		try {
+			listener.enter(NK_SXL);
+			Token* token;
+			// Loop if next token is not EOF
+			while ( ( token = nextToken() )->getType() != TK_EOF ) {
+				previousToken();
+				emitter.walkIterative( parseTopLevelStatement() );
+				scratch.reset();
+			}
+			listener.leave(NK_SXL);
+		} catch( ParseException &e ) {
+			arena = saved;
+			lazy = savedLazy;
+			throw;
+		}
+		arena = saved;
+		lazy = savedLazy;
+	}
+
+
 };
 
 
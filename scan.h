@@ -0,0 +1,342 @@
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define SCAN_SSE2
+#endif
+
+using namespace std;
+
+/**
+ * Character classes scanned by the Scan kernels.
+ * Each class tells whether a character continues a run (scalar), and builds the
+ * same answer for 16 (SSE2) or 32 (AVX2) characters at once, as a byte mask with
+ * 0xFF for every character that continues the run.
+ */
+
+// Whitespace skipped between tokens: ' ', '\t' and '\n'
+struct WhitespaceRun {
+	static bool scalar(char c) {
+		return c == ' ' || c == '\t' || c == '\n';
+	}
+#ifdef SCAN_SSE2
+	static __m128i sse2(__m128i v) {
+		__m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+		__m128i tb = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+		__m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+		return _mm_or_si128(sp, _mm_or_si128(tb, nl));
+	}
+	__attribute__((target("avx2")))
+	static __m256i avx2(__m256i v) {
+		__m256i sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+		__m256i tb = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'));
+		__m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+		return _mm256_or_si256(sp, _mm256_or_si256(tb, nl));
+	}
+#endif
+};
+
+// Identifier characters: letters, digits and '_'
+struct IdentifierRun {
+	static bool scalar(char c) {
+		return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+	}
+#ifdef SCAN_SSE2
+	// Signed compares: characters >= 0x80 are negative, and never in a range
+	static __m128i sse2(__m128i v) {
+		// Folding to lower case maps exactly 'A'-'Z' and 'a'-'z' onto 'a'-'z'
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		__m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+		return _mm_or_si128(alpha, _mm_or_si128(digit, under));
+	}
+	__attribute__((target("avx2")))
+	static __m256i avx2(__m256i v) {
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+		__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+		__m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+		return _mm256_or_si256(alpha, _mm256_or_si256(digit, under));
+	}
+#endif
+};
+
+// String literal body: printable characters, except '"' and '\\'
+struct StringBodyRun {
+	static bool scalar(char c) {
+		return c >= '\x20' && c <= '\x7E' && c != '"' && c != '\\';
+	}
+#ifdef SCAN_SSE2
+	static __m128i sse2(__m128i v) {
+		// Characters below 0x20, and all characters >= 0x80, compare lower than 0x20
+		__m128i control = _mm_cmplt_epi8(v, _mm_set1_epi8('\x20'));
+		__m128i del = _mm_cmpeq_epi8(v, _mm_set1_epi8('\x7F'));
+		__m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+		__m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+		__m128i stop = _mm_or_si128(_mm_or_si128(control, del), _mm_or_si128(quote, slash));
+		return _mm_xor_si128(stop, _mm_set1_epi8(-1));
+	}
+	__attribute__((target("avx2")))
+	static __m256i avx2(__m256i v) {
+		__m256i control = _mm256_cmpgt_epi8(_mm256_set1_epi8('\x20'), v);
+		__m256i del = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\x7F'));
+		__m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+		__m256i slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+		__m256i stop = _mm256_or_si256(_mm256_or_si256(control, del), _mm256_or_si256(quote, slash));
+		return _mm256_xor_si256(stop, _mm256_set1_epi8(-1));
+	}
+#endif
+};
+
+
+/**
+ * Returns the end of the run of class C characters starting at p: the first
+ * character in [p, end) that does not continue the run, or end.
+ */
+template <class C>
+const char* scanRunScalar(const char* p, const char* end) {
+	while ( p < end && C::scalar(*p) ) {
+		p++;
+	}
+	return p;
+}
+
+/**
+ * Returns the first '*' in [p, end) that is followed by a '/', or end if there is none.
+ */
+inline const char* scanCommentEndScalar(const char* p, const char* end) {
+	for ( ; p + 1 < end; p++ ) {
+		if ( p[0] == '*' && p[1] == '/' ) {
+			return p;
+		}
+	}
+	return end;
+}
+
+/**
+ * Counts the occurrences of the character c in [p, end).
+ */
+inline size_t countCharScalar(const char* p, const char* end, char c) {
+	size_t n = 0;
+	for ( ; p < end; p++ ) {
+		n += ( *p == c );
+	}
+	return n;
+}
+
+/**
+ * Appends the offset from base of the character after each new line in [p, end).
+ */
+inline void lineStartsScalar(const char* p, const char* end, const char* base, vector<uint32_t>& starts) {
+	for ( ; p < end; p++ ) {
+		if ( *p == '\n' ) {
+			starts.push_back( p + 1 - base );
+		}
+	}
+}
+
+
+#ifdef SCAN_SSE2
+
+template <class C>
+const char* scanRunSSE2(const char* p, const char* end) {
+	for ( ; p + 16 <= end; p += 16 ) {
+		__m128i v = _mm_loadu_si128((const __m128i*) p);
+		unsigned stop = ~_mm_movemask_epi8(C::sse2(v)) & 0xFFFF;
+		if ( stop != 0 ) {
+			return p + __builtin_ctz(stop);
+		}
+	}
+	return scanRunScalar<C>(p, end);
+}
+
+template <class C>
+__attribute__((target("avx2")))
+const char* scanRunAVX2(const char* p, const char* end) {
+	for ( ; p + 32 <= end; p += 32 ) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) p);
+		unsigned stop = ~(unsigned) _mm256_movemask_epi8(C::avx2(v));
+		if ( stop != 0 ) {
+			return p + __builtin_ctz(stop);
+		}
+	}
+	return scanRunScalar<C>(p, end);
+}
+
+inline const char* scanCommentEndSSE2(const char* p, const char* end) {
+	// Compare each block with the block one character ahead, so that a '*' at
+	// position i and a '/' at position i+1 show up as the same bit
+	for ( ; p + 17 <= end; p += 16 ) {
+		__m128i star = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p), _mm_set1_epi8('*'));
+		__m128i slash = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (p + 1)), _mm_set1_epi8('/'));
+		unsigned hit = _mm_movemask_epi8(_mm_and_si128(star, slash));
+		if ( hit != 0 ) {
+			return p + __builtin_ctz(hit);
+		}
+	}
+	return scanCommentEndScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* scanCommentEndAVX2(const char* p, const char* end) {
+	for ( ; p + 33 <= end; p += 32 ) {
+		__m256i star = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p), _mm256_set1_epi8('*'));
+		__m256i slash = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (p + 1)), _mm256_set1_epi8('/'));
+		unsigned hit = _mm256_movemask_epi8(_mm256_and_si256(star, slash));
+		if ( hit != 0 ) {
+			return p + __builtin_ctz(hit);
+		}
+	}
+	return scanCommentEndScalar(p, end);
+}
+
+inline size_t countCharSSE2(const char* p, const char* end, char c) {
+	size_t n = 0;
+	__m128i needle = _mm_set1_epi8(c);
+	for ( ; p + 16 <= end; p += 16 ) {
+		__m128i v = _mm_loadu_si128((const __m128i*) p);
+		n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+	}
+	return n + countCharScalar(p, end, c);
+}
+
+__attribute__((target("avx2")))
+inline size_t countCharAVX2(const char* p, const char* end, char c) {
+	size_t n = 0;
+	__m256i needle = _mm256_set1_epi8(c);
+	for ( ; p + 32 <= end; p += 32 ) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) p);
+		n += __builtin_popcount((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+	}
+	return n + countCharScalar(p, end, c);
+}
+
+inline void lineStartsSSE2(const char* p, const char* end, const char* base, vector<uint32_t>& starts) {
+	__m128i nl = _mm_set1_epi8('\n');
+	for ( ; p + 16 <= end; p += 16 ) {
+		unsigned hit = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p), nl));
+		for ( ; hit != 0; hit &= hit - 1 ) {
+			starts.push_back( p + __builtin_ctz(hit) + 1 - base );
+		}
+	}
+	lineStartsScalar(p, end, base, starts);
+}
+
+__attribute__((target("avx2")))
+inline void lineStartsAVX2(const char* p, const char* end, const char* base, vector<uint32_t>& starts) {
+	__m256i nl = _mm256_set1_epi8('\n');
+	for ( ; p + 32 <= end; p += 32 ) {
+		unsigned hit = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p), nl));
+		for ( ; hit != 0; hit &= hit - 1 ) {
+			starts.push_back( p + __builtin_ctz(hit) + 1 - base );
+		}
+	}
+	lineStartsScalar(p, end, base, starts);
+}
+
+#endif
+
+
+/**
+ * The Scan class.
+ * Finds the end of character runs (whitespace, identifiers, string literal bodies and
+ * block comments) several characters at a time. The widest kernel supported by the
+ * CPU is chosen once, at the first call: AVX2 if the CPU has it, otherwise SSE2 on
+ * x86, or plain scalar code elsewhere.
+ */
+class Scan {
+	private:
+		struct Kernels {
+			const char* (*whitespace)(const char*, const char*);
+			const char* (*identifier)(const char*, const char*);
+			const char* (*stringBody)(const char*, const char*);
+			const char* (*commentEnd)(const char*, const char*);
+			size_t (*count)(const char*, const char*, char);
+			void (*lineStarts)(const char*, const char*, const char*, vector<uint32_t>&);
+		};
+
+		static Kernels select() {
+			Kernels k;
+#ifdef SCAN_SSE2
+			if ( __builtin_cpu_supports("avx2") ) {
+				k.whitespace = scanRunAVX2<WhitespaceRun>;
+				k.identifier = scanRunAVX2<IdentifierRun>;
+				k.stringBody = scanRunAVX2<StringBodyRun>;
+				k.commentEnd = scanCommentEndAVX2;
+				k.count = countCharAVX2;
+				k.lineStarts = lineStartsAVX2;
+				return k;
+			}
+			k.whitespace = scanRunSSE2<WhitespaceRun>;
+			k.identifier = scanRunSSE2<IdentifierRun>;
+			k.stringBody = scanRunSSE2<StringBodyRun>;
+			k.commentEnd = scanCommentEndSSE2;
+			k.count = countCharSSE2;
+			k.lineStarts = lineStartsSSE2;
+			return k;
+#else
+			k.whitespace = scanRunScalar<WhitespaceRun>;
+			k.identifier = scanRunScalar<IdentifierRun>;
+			k.stringBody = scanRunScalar<StringBodyRun>;
+			k.commentEnd = scanCommentEndScalar;
+			k.count = countCharScalar;
+			k.lineStarts = lineStartsScalar;
+			return k;
+#endif
+		}
+
+		static const Kernels& kernels() {
+			static const Kernels k = Scan::select();
+			return k;
+		}
+
+	public:
+		/** Returns the end of the run of whitespace characters starting at p. */
+		static const char* whitespace(const char* p, const char* end) {
+			return Scan::kernels().whitespace(p, end);
+		}
+
+		/** Returns the end of the run of identifier characters starting at p. */
+		static const char* identifier(const char* p, const char* end) {
+			return Scan::kernels().identifier(p, end);
+		}
+
+		/**
+		 * Returns the end of the run of string literal characters starting at p, that
+		 * is, the first non-printable character, double quote or backslash.
+		 */
+		static const char* stringBody(const char* p, const char* end) {
+			return Scan::kernels().stringBody(p, end);
+		}
+
+		/**
+		 * Returns the '*' of the first block comment terminator at or after p, or end
+		 * if the comment is not terminated.
+		 */
+		static const char* commentEnd(const char* p, const char* end) {
+			return Scan::kernels().commentEnd(p, end);
+		}
+
+		/** Counts the occurrences of c in [p, end). */
+		static size_t count(const char* p, const char* end, char c) {
+			return Scan::kernels().count(p, end, c);
+		}
+
+		/**
+		 * Appends to starts the offset from base of the character after each new line
+		 * in [p, end), that is, the start of each line after the first.
+		 */
+		static void lineStarts(const char* p, const char* end, const char* base, vector<uint32_t>& starts) {
+			Scan::kernels().lineStarts(p, end, base, starts);
+		}
+};
+
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef __SOURCE_BUFFER_H__
+#define __SOURCE_BUFFER_H__
+
+#include <string>
+#include <mutex>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "line-table.h"
+
+using namespace std;
+
+/**
+ * The SourceBuffer class.
+ * Holds the whole source text in one contiguous block of memory, so that it can be
+ * scanned with a plain pointer. The block is either a read-only memory mapping of
+ * the source file, or a string owned by the buffer.
+ */
+class SourceBuffer {
+	private:
+		// The file path of the source file (empty for in-memory sources)
+		string filepath;
+		// The owned contents, used when the source is not memory-mapped
+		string contents;
+		// The mapped region, or NULL if the source is not memory-mapped
+		void* mapping;
+		// The first character of the source
+		const char* start;
+		// The number of characters in the source
+		size_t length;
+		// The start of each line, found on first use
+		LineTable* lines;
+		once_flag linesOnce;
+
+		SourceBuffer(const SourceBuffer&) = delete;
+		SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+	public:
+		/**
+		 * Constructor.
+		 * Takes ownership of the given source text.
+		 */
+		SourceBuffer(string contents, string filepath = "") {
+			this->filepath = filepath;
+			this->contents.swap(contents);
+			this->mapping = NULL;
+			this->start = this->contents.data();
+			this->length = this->contents.length();
+			this->lines = NULL;
+		}
+
+		~SourceBuffer() {
+			delete this->lines;
+			if ( this->mapping != NULL ) {
+				munmap(this->mapping, this->length);
+			}
+		}
+
+		/**
+		 * Memory-maps the file at the given path.
+		 * A file that cannot be opened or mapped results in an empty buffer, the
+		 * same way an unreadable file stream reads as an immediate end of file.
+		 */
+		static SourceBuffer* fromFile(string filepath) {
+			SourceBuffer* source = new SourceBuffer("", filepath);
+
+			int fd = open(filepath.c_str(), O_RDONLY);
+			if ( fd < 0 ) {
+				return source;
+			}
+			struct stat st;
+			if ( fstat(fd, &st) == 0 && st.st_size > 0 ) {
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if ( m != MAP_FAILED ) {
+					// The lexer reads the file front to back, exactly once
+					madvise(m, st.st_size, MADV_SEQUENTIAL);
+					source->mapping = m;
+					source->start = (const char*) m;
+					source->length = st.st_size;
+				}
+			}
+			close(fd);
+			return source;
+		}
+
+		/** Returns a pointer to the first character of the source. */
+		const char* data() {
+			return this->start;
+		}
+
+		/** Returns the number of characters in the source. */
+		size_t size() {
+			return this->length;
+		}
+
+		/**
+		 * Returns the line table of the source, which is built by the first call.
+		 * May be called from several threads.
+		 */
+		LineTable& getLines() {
+			call_once( this->linesOnce, [this]() {
+				this->lines = new LineTable( this->start, this->length );
+			} );
+			return *this->lines;
+		}
+		/** Returns the row of the given offset, from 1. */
+		int getRow(size_t offset) {
+			return this->getLines().row(offset);
+		}
+		/** Returns the column of the given offset, from 1. */
+		int getCol(size_t offset) {
+			return this->getLines().col(offset);
+		}
+
+		/** Returns the path of the source file. */
+		string getFilePath() {
+			return this->filepath;
+		}
+};
+
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef __SYMBOL_TABLE_H__
+#define __SYMBOL_TABLE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * The symbol ID of tokens and nodes that have none.
+ */
+const uint32_t NO_SYMBOL = 0xFFFFFFFF;
+
+/**
+ * The SymbolTable class.
+ * Interns identifiers: every distinct name gets a dense 32-bit ID, starting at 0,
+ * so that names can be compared by ID and stored once.
+ *
+ * The table can be shared by lexers running on several threads. Names are split
+ * in shards by hash, each with its own lock, so that threads rarely wait for each
+ * other. IDs are handed out by a single atomic counter, and the names are stored in
+ * chunks that never move, so that name(id) needs no lock.
+ */
+class SymbolTable {
+
+	private:
+		// Number of shards (a power of 2)
+		static const size_t SHARD_BITS = 6;
+		static const size_t SHARDS = 1 << SHARD_BITS;
+		// Size of the first chunk of entries. Each chunk is twice the size of the last.
+		static const size_t FIRST_CHUNK = 1024;
+		static const size_t CHUNKS = 23;
+		// Size of the blocks holding the names
+		static const size_t BLOCK_SIZE = 1 << 16;
+
+		// An interned name
+		struct Entry {
+			const char* name;
+			uint32_t length;
+			uint32_t hash;
+		};
+
+		// A shard: an open addressing hash table of IDs, and the characters of the names
+		struct Shard {
+			mutex lock;
+			vector<uint32_t> slots;
+			size_t count = 0;
+			vector<char*> blocks;
+			size_t used = BLOCK_SIZE;
+		};
+
+		Shard shards[SHARDS];
+		// The entries, by ID
+		atomic<Entry*> chunks[CHUNKS];
+		// Number of IDs handed out
+		atomic<uint32_t> count;
+
+		SymbolTable(const SymbolTable&) = delete;
+		SymbolTable& operator=(const SymbolTable&) = delete;
+
+		static uint64_t hash(const char* s, size_t length) {
+			// FNV-1a
+			uint64_t h = 14695981039346656037ULL;
+			for ( size_t i = 0; i < length; i++ ) {
+				h = ( h ^ (unsigned char) s[i] ) * 1099511628211ULL;
+			}
+			return h;
+		}
+
+		/**
+		 * Returns the chunk of the given ID, and the index of the ID in it.
+		 */
+		static size_t chunkOf(uint32_t id, size_t* index) {
+			size_t n = id / FIRST_CHUNK + 1;
+			size_t chunk = 63 - __builtin_clzll(n);
+			*index = id - FIRST_CHUNK * ( ( (size_t) 1 << chunk ) - 1 );
+			return chunk;
+		}
+
+		Entry* entry(uint32_t id) {
+			size_t index;
+			size_t chunk = SymbolTable::chunkOf(id, &index);
+			return &this->chunks[chunk].load(memory_order_acquire)[index];
+		}
+
+		/**
+		 * Returns the entry of a new ID, allocating its chunk if needed.
+		 */
+		Entry* newEntry(uint32_t id) {
+			size_t index;
+			size_t chunk = SymbolTable::chunkOf(id, &index);
+			Entry* entries = this->chunks[chunk].load(memory_order_acquire);
+			if ( entries == NULL ) {
+				Entry* fresh = new Entry[ FIRST_CHUNK << chunk ];
+				if ( this->chunks[chunk].compare_exchange_strong(entries, fresh, memory_order_acq_rel) ) {
+					entries = fresh;
+				} else {
+					// Another thread allocated it first
+					delete[] fresh;
+				}
+			}
+			return &entries[index];
+		}
+
+		/**
+		 * Copies a name into the blocks of a shard.
+		 */
+		static const char* store(Shard& shard, const char* s, size_t length) {
+			if ( length > BLOCK_SIZE / 4 ) {
+				// Long names get a block of their own
+				char* block = new char[length];
+				shard.blocks.insert( shard.blocks.begin(), block );
+				memcpy(block, s, length);
+				return block;
+			}
+			if ( shard.used + length > BLOCK_SIZE ) {
+				shard.blocks.push_back( new char[BLOCK_SIZE] );
+				shard.used = 0;
+			}
+			char* p = shard.blocks.back() + shard.used;
+			memcpy(p, s, length);
+			shard.used += length;
+			return p;
+		}
+
+		/**
+		 * Doubles the hash table of a shard.
+		 */
+		void grow(Shard& shard) {
+			vector<uint32_t> slots( shard.slots.empty()? 64 : shard.slots.size() * 2, NO_SYMBOL );
+			size_t mask = slots.size() - 1;
+			for ( size_t i = 0; i < shard.slots.size(); i++ ) {
+				uint32_t id = shard.slots[i];
+				if ( id != NO_SYMBOL ) {
+					size_t j = this->entry(id)->hash & mask;
+					while ( slots[j] != NO_SYMBOL ) {
+						j = ( j + 1 ) & mask;
+					}
+					slots[j] = id;
+				}
+			}
+			shard.slots.swap(slots);
+		}
+
+	public:
+		SymbolTable() {
+			for ( size_t i = 0; i < CHUNKS; i++ ) {
+				this->chunks[i].store(NULL);
+			}
+			this->count.store(0);
+		}
+
+		~SymbolTable() {
+			for ( size_t i = 0; i < CHUNKS; i++ ) {
+				delete[] this->chunks[i].load();
+			}
+			for ( size_t i = 0; i < SHARDS; i++ ) {
+				for ( size_t j = 0; j < this->shards[i].blocks.size(); j++ ) {
+					delete[] this->shards[i].blocks[j];
+				}
+			}
+		}
+
+		/**
+		 * Returns the ID of the given name, giving it a new one if it has none yet.
+		 */
+		uint32_t intern(const char* s, size_t length) {
+			uint64_t h = SymbolTable::hash(s, length);
+			Shard& shard = this->shards[ h >> ( 64 - SHARD_BITS ) ];
+			uint32_t h32 = (uint32_t) h;
+
+			lock_guard<mutex> guard(shard.lock);
+			// Keep the table at most half full
+			if ( 2 * ( shard.count + 1 ) > shard.slots.size() ) {
+				this->grow(shard);
+			}
+			size_t mask = shard.slots.size() - 1;
+			size_t i = h32 & mask;
+			while ( shard.slots[i] != NO_SYMBOL ) {
+				Entry* e = this->entry( shard.slots[i] );
+				if ( e->hash == h32 && e->length == length && memcmp(e->name, s, length) == 0 ) {
+					return shard.slots[i];
+				}
+				i = ( i + 1 ) & mask;
+			}
+
+			// New name
+			uint32_t id = this->count.fetch_add(1);
+			Entry* e = this->newEntry(id);
+			e->name = SymbolTable::store(shard, s, length);
+			e->length = length;
+			e->hash = h32;
+			shard.slots[i] = id;
+			shard.count++;
+			return id;
+		}
+		uint32_t intern(const string& name) {
+			return this->intern( name.data(), name.length() );
+		}
+
+		/**
+		 * Returns the name of the given ID.
+		 */
+		string name(uint32_t id) {
+			Entry* e = this->entry(id);
+			return string(e->name, e->length);
+		}
+
+		/**
+		 * Returns the number of IDs handed out.
+		 */
+		size_t size() {
+			return this->count.load();
+		}
+};
+
+
+#endif
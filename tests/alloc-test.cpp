@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include "lexer.h"
+#include "symbol-table.h"
+
+using namespace std;
+
+/**
+ * Allocation test.
+ * Counts the heap allocations made while lexing sources of the same lines repeated
+ * a growing number of times. Steady-state lexing must not allocate per token: the
+ * counts may only grow by the few reallocations of vectors that double, and the arena
+ * blocks of the decoded strings, far fewer than the tokens.
+ */
+
+// Set while allocations are counted
+static bool counting = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+	if ( counting ) {
+		allocations++;
+	}
+	void* p = malloc( size? size : 1 );
+	if ( p == NULL ) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+// Lines of all the kinds of tokens, with a string of escapes
+static const char* const LINES =
+	"function add( x : int, y : real ) : int {\n"
+	"\tlet z : int = x + y * 12345 - 3.25e-2;\n"
+	"\tif ( z >= 10 and not ( y == 0.5 ) or true ) {\n"
+	"\t\tset z <- (int) 'c' + '\\n';\n"
+	"\t\tlet s : string = \"a \\\"quoted\\\" string\\t\";\n"
+	"\t}\n"
+	"\t/* block comment */\n"
+	"\twhile ( z != # ) { write z; read z; } // line comment\n"
+	"\tz;\n"
+	"}\n";
+
+// Number of repeats of the lines in the smallest source
+static const size_t REPEATS = 4000;
+// Tokens per allocation allowed in the larger sources, beyond those of the smallest one
+static const size_t TOKENS_PER_ALLOCATION = 1000;
+
+static string generate(size_t repeats) {
+	string source;
+	for ( size_t i = 0; i < repeats; i++ ) {
+		source += LINES;
+	}
+	return source;
+}
+
+enum Mode { GENERATE, SCAN, STREAM };
+static const char* const NAMES[] = { "generateTokens()", "scanToken()", "streaming nextToken()" };
+
+/**
+ * Lexes a source of the lines repeated the given number of times, and returns the
+ * number of allocations made, setting the number of tokens.
+ */
+static size_t count(Mode mode, size_t repeats, size_t* tokens) {
+	SourceBuffer source( generate(repeats) );
+	SymbolTable symbols;
+	Lexer lexer(&source);
+	lexer.setSymbolTable(&symbols);
+	lexer.setStreaming( mode == STREAM );
+
+	allocations = 0;
+	counting = true;
+	*tokens = 0;
+	if ( mode == GENERATE ) {
+		lexer.generateTokens();
+		*tokens = lexer.getTokens().size();
+	} else if ( mode == SCAN ) {
+		while ( lexer.scanToken() != NULL ) {
+			(*tokens)++;
+		}
+	} else {
+		while ( !lexer.nextToken()->isEOF() ) {
+			(*tokens)++;
+		}
+	}
+	counting = false;
+
+	if ( lexer.hasFailed() ) {
+		cerr << "Lexing failed" << endl;
+		exit(1);
+	}
+	return allocations;
+}
+
+int main() {
+	bool passed = true;
+	for ( int mode = GENERATE; mode <= STREAM; mode++ ) {
+		size_t tokens;
+		size_t base = count( (Mode) mode, REPEATS, &tokens );
+		for ( size_t factor = 2; factor <= 8; factor *= 2 ) {
+			size_t more;
+			size_t n = count( (Mode) mode, REPEATS * factor, &more );
+			bool ok = ( n <= base + ( more - tokens ) / TOKENS_PER_ALLOCATION );
+			cout << ( ok? "PASS " : "FAIL " ) << NAMES[mode] << ": " << more << " tokens, "
+				<< n << " allocations (" << base << " for " << tokens << " tokens)" << endl;
+			passed = passed && ok;
+		}
+	}
+	return passed? 0 : 1;
+}
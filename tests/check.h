@@ -0,0 +1,39 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Checks for the tests: each test is a program that runs its checks, prints those that
+ * fail, and returns checkResult() from main(), which ctest takes as the result.
+ */
+
+// Number of checks run, and of those that failed
+static size_t checks = 0;
+static size_t failures = 0;
+
+/**
+ * Checks a condition. If it does not hold, prints it with its place and the given
+ * context, which is anything that can be written to a stream.
+ */
+#define CHECK(condition, context) \
+	do { \
+		checks++; \
+		if ( !(condition) ) { \
+			failures++; \
+			cout << __FILE__ << ":" << __LINE__ << ": FAIL " << #condition << ": " << context << endl; \
+		} \
+	} while ( false )
+
+/**
+ * Prints the number of checks that failed, and returns the exit code of the test.
+ */
+inline int checkResult() {
+	cout << ( checks - failures ) << " of " << checks << " checks passed" << endl;
+	return ( failures == 0 )? 0 : 1;
+}
+
+
+#endif
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "lexer.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * Table-driven lexer test.
+ * Lexes a source with both the hand-written and the table-driven scanners, and checks
+ * that they produce the same tokens and stop the same way. The sources are the given
+ * file, and mutations of it with characters that start, end or break tokens.
+ *
+ *	dfa-test <path>
+ */
+
+// Number of mutated sources, and of edits in each
+static const size_t MUTANTS = 3000;
+static const size_t EDITS = 4;
+
+// Characters of the edits
+static const char CHARS[] = "\"'\\/*\n .e+-0123456789<>=!#_az{}();:,\t\x01\xE9";
+
+// Deterministic pseudo-random numbers, so that every run checks the same sources
+static uint32_t seed = 4321;
+
+static uint32_t rnd(uint32_t n) {
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 16 ) % n;
+}
+
+/**
+ * Returns the first difference between the scanners on the source, or an empty string.
+ */
+static string crossCheck(SourceBuffer* source) {
+	Lexer hand(source);
+	Lexer table(source);
+	hand.setQuiet(true);
+	table.setQuiet(true);
+	table.setTableDriven(true);
+	for ( size_t i = 0; ; i++ ) {
+		Token* a = hand.scanToken();
+		Token* b = table.scanToken();
+		stringstream ss;
+		if ( a == NULL || b == NULL ) {
+			if ( a != NULL || b != NULL || hand.hasFailed() != table.hasFailed() ) {
+				ss << "the scanners differ at the end of input, after token #" << i;
+			}
+			return ss.str();
+		}
+		if ( a->getType() != b->getType() || a->getSubtype() != b->getSubtype() || a->getOffset() != b->getOffset()
+				|| a->getLength() != b->getLength() ) {
+			ss << "the scanners differ at token #" << i << ": " << hand.describe(a) << " / " << table.describe(b);
+			return ss.str();
+		}
+	}
+}
+
+/**
+ * Returns the source with a few characters inserted, removed or replaced.
+ */
+static string mutate(const string& source) {
+	string s = source;
+	for ( size_t i = 0; i < EDITS; i++ ) {
+		size_t at = rnd( s.length() + 1 );
+		char c = CHARS[ rnd( sizeof(CHARS) - 1 ) ];
+		switch ( rnd(3) ) {
+			case 0:
+				s.insert( at, 1, c );
+				break;
+			case 1:
+				if ( at < s.length() ) s.erase( at, 1 );
+				break;
+			default:
+				if ( at < s.length() ) s[at] = c;
+				break;
+		}
+	}
+	return s;
+}
+
+int main(int argc, char** argv) {
+	if ( argc < 2 ) {
+		cerr << "Usage: dfa-test <path>" << endl;
+		return 2;
+	}
+	SourceBuffer* file = SourceBuffer::fromFile(argv[1]);
+	string source( file->data(), file->size() );
+	delete file;
+	CHECK( !source.empty(), "cannot read " << argv[1] );
+
+	SourceBuffer original(source);
+	string difference = crossCheck(&original);
+	CHECK( difference.empty(), argv[1] << ": " << difference );
+
+	for ( size_t i = 0; i < MUTANTS; i++ ) {
+		SourceBuffer mutant( mutate(source) );
+		difference = crossCheck(&mutant);
+		CHECK( difference.empty(), "mutant #" << i << ": " << difference );
+	}
+	return checkResult();
+}
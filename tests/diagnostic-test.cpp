@@ -0,0 +1,135 @@
+#include <iostream>
+#include <string>
+#include "lexer.h"
+#include "parser.h"
+#include "ast-writer.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * Error recovery test.
+ * Parses sources with several syntax errors, at the top level and in nested blocks,
+ * with Parser::parseSXL(DiagnosticCollector&), and checks the code and token of each
+ * error collected, and that the statements without errors are those returned, as
+ * parsing them alone gives. This is done in each mode of the parser.
+ *
+ *	diagnostic-test
+ */
+
+struct ErrorCase {
+	// The offending token
+	size_t index;
+	const char* image;
+	// The code in backtracking and packrat modes, and in predictive modes, which
+	// tell more precisely what they expected
+	DiagnosticCode code;
+	DiagnosticCode predictiveCode;
+};
+
+struct SourceCase {
+	const char* source;
+	// The statements without errors
+	const char* statements;
+	const ErrorCase* errors;
+	size_t errorCount;
+};
+
+static const char* const NESTED =
+	"let a : int = 1;\n"
+	"let b : foo = 2;\n"
+	"write a;\n"
+	"write ;\n"
+	"while ( a < 10 ) {\n"
+	"	write a;\n"
+	"	let c : int = ;\n"
+	"	write c;\n"
+	"}\n"
+	"write a;\n"
+	"if ( a == 2 ) {\n"
+	"	while ( a ) {\n"
+	"		let d : int = * 2;\n"
+	"	}\n"
+	"	write a;\n"
+	"}\n"
+	"set a <- a + 1;\n"
+	"halt 0;\n";
+
+static const ErrorCase NESTED_ERRORS[] = {
+	// At the top level
+	{ 10, "foo", DG_EXPECTED, DG_UNKNOWN_TYPE },
+	{ 18, ";", DG_EXPECTED, DG_EXPECTED },
+	// In a block, whose other statements are skipped
+	{ 34, ";", DG_EXPECTED, DG_EXPECTED },
+	// In a block in a block
+	{ 59, "*", DG_EXPECTED, DG_EXPECTED },
+};
+
+// Lexing stops on the unterminated string, at the end of input
+static const char* const UNTERMINATED =
+	"write a;\n"
+	"let s : string = \"abc";
+
+static const ErrorCase UNTERMINATED_ERRORS[] = {
+	{ 8, "eof", DG_EXPECTED, DG_EXPECTED },
+};
+
+static const SourceCase SOURCES[] = {
+	{ NESTED, "let a : int = 1;\nwrite a;\nwrite a;\nset a <- a + 1;\nhalt 0;\n", NESTED_ERRORS, 4 },
+	{ UNTERMINATED, "write a;\n", UNTERMINATED_ERRORS, 1 },
+};
+
+static const char* const MODES[] = { "backtracking", "predictive", "climbing", "packrat" };
+enum Mode { BACKTRACKING, PREDICTIVE, CLIMBING, PACKRAT, MODE_COUNT };
+
+static void setMode(Parser& parser, Mode mode) {
+	parser.setPredictive( mode == PREDICTIVE || mode == CLIMBING );
+	parser.setPrecedenceClimbing( mode == CLIMBING );
+	parser.setPackrat( mode == PACKRAT );
+}
+
+/**
+ * Returns the tree of a source without errors.
+ */
+static string parse(const char* text, Mode mode) {
+	SourceBuffer source(text);
+	Lexer lexer(&source);
+	lexer.generateTokens();
+	Parser parser(&lexer);
+	setMode(parser, mode);
+	return parser.parseSXL()->toString();
+}
+
+static void test(const SourceCase& c, Mode mode) {
+	SourceBuffer source(c.source);
+	Lexer lexer(&source);
+	lexer.setQuiet(true);
+	lexer.generateTokens();
+	Parser parser(&lexer);
+	setMode(parser, mode);
+	DiagnosticCollector diagnostics;
+	ASTNode* tree = parser.parseSXL(diagnostics);
+
+	string context = string(MODES[mode]) + ", [" + c.statements + "]";
+	CHECK( diagnostics.size() == c.errorCount, context << ": " << diagnostics.size() << " errors" );
+	for ( size_t i = 0; i < diagnostics.size() && i < c.errorCount; i++ ) {
+		const Diagnostic& diagnostic = diagnostics.at(i).getDiagnostic();
+		const ErrorCase& expected = c.errors[i];
+		DiagnosticCode code = ( mode == PREDICTIVE || mode == CLIMBING )? expected.predictiveCode : expected.code;
+		Token token = diagnostic.getToken();
+		string image = token.getImage( source.data() );
+		CHECK( diagnostic.getCode() == code, context << ": error #" << i << " is " << diagnostics.at(i).what() );
+		CHECK( diagnostic.getTokenIndex() == expected.index, context << ": error #" << i << " at token #" << diagnostic.getTokenIndex() );
+		CHECK( image == expected.image, context << ": error #" << i << " at [" << image << "]" );
+	}
+	CHECK( tree->toString() == parse(c.statements, mode), context << ": returned\n" << tree->toString() );
+}
+
+int main() {
+	for ( const SourceCase& c : SOURCES ) {
+		for ( int mode = BACKTRACKING; mode < MODE_COUNT; mode++ ) {
+			test( c, (Mode) mode );
+		}
+	}
+	return checkResult();
+}
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "lexer.h"
+#include "parser.h"
+#include "flat-ast.h"
+#include "ast-cache.h"
+#include "ast-writer.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * FlatAST byte form and ASTCache test.
+ * Checks that a tree written by FlatAST::toBytes() loads back with fromBytes() as the
+ * tree built from parsing the source, with the same values of literals, and that
+ * truncated, flipped, wrong version and out of bounds forms are rejected. Then checks
+ * that ASTCache takes a corrupted file, or the file of another source, as a miss, and
+ * writes the tree again.
+ *
+ *	flat-ast-test <path>
+ */
+
+// A source with literals of every kind
+static const char* const LITERALS =
+	"let i : int = 9223372036854775807;\n"
+	"let r : real = 1.5e-3 + 2.0;\n"
+	"let c : char = '\\n';\n"
+	"let s : string = \"tab\\there, \\\"quoted\\\"\";\n"
+	"let t : string = \"plain\";\n"
+	"let b : bool = true;\n"
+	"write s;\n";
+
+// Offsets in the form of fields of the header
+static const size_t VERSION_AT = 4;
+static const size_t CHECKSUM_AT = 8;
+static const size_t NODES_AT = 16;
+static const size_t HEADER_SIZE = 32;
+
+static uint32_t seed = 99;
+
+static uint32_t rnd(uint32_t n) {
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 16 ) % n;
+}
+
+static uint32_t get(const string& bytes, size_t at) {
+	uint32_t n;
+	memcpy( &n, bytes.data() + at, sizeof(n) );
+	return n;
+}
+
+static void put(string& bytes, size_t at, uint32_t n) {
+	memcpy( &bytes[at], &n, sizeof(n) );
+}
+
+/**
+ * Sets the checksum of a form, after it is changed, so that it is only rejected if
+ * it is not a valid tree. The checksum is the CRC-32 of the form with a checksum of 0.
+ */
+static void seal(string& bytes) {
+	put( bytes, CHECKSUM_AT, 0 );
+	uint32_t crc = 0xFFFFFFFF;
+	for ( size_t i = 0; i < bytes.size(); i++ ) {
+		crc ^= (uint8_t) bytes[i];
+		for ( int k = 0; k < 8; k++ ) {
+			crc = ( crc & 1 )? 0xEDB88320 ^ ( crc >> 1 ) : crc >> 1;
+		}
+	}
+	put( bytes, CHECKSUM_AT, ~crc );
+}
+
+static bool rejected(const string& bytes) {
+	FlatAST* flat = FlatAST::fromBytes( bytes.data(), bytes.size() );
+	delete flat;
+	return flat == NULL;
+}
+
+/**
+ * Returns the tree of the source, parsed with parseSXL(), as a FlatAST.
+ */
+static FlatAST* flatten(SourceBuffer* source) {
+	Lexer lexer(source);
+	lexer.generateTokens();
+	Parser parser(&lexer);
+	return FlatAST::fromTree( parser.parseSXL() );
+}
+
+/**
+ * Checks that the byte form of the tree of the source loads back as that tree.
+ */
+static void testRoundTrip(SourceBuffer* source, const string& name) {
+	FlatAST* flat = flatten(source);
+	string bytes;
+	flat->toBytes(bytes);
+	FlatAST* loaded = FlatAST::fromBytes( bytes.data(), bytes.size() );
+	CHECK( loaded != NULL, name << ": the form of the tree is rejected" );
+	if ( loaded == NULL ) {
+		return;
+	}
+	CHECK( loaded->toString() == flat->toString(), name << ": the trees differ" );
+	CHECK( loaded->size() == flat->size(), name );
+	for ( uint32_t id = 0; id < flat->size() && id < loaded->size(); id++ ) {
+		Literal a = flat->literal(id);
+		Literal b = loaded->literal(id);
+		switch ( flat->kind(id) ) {
+			case NK_STRING_LITERAL:
+				CHECK( a.length == b.length && memcmp( a.text, b.text, a.length ) == 0, name << ": string #" << id );
+				break;
+			case NK_INTEGER_LITERAL:
+			case NK_REAL_LITERAL:
+				CHECK( a.integer == b.integer, name << ": the value of literal #" << id );
+				break;
+			case NK_CHAR_LITERAL:
+				CHECK( a.character == b.character, name << ": the value of literal #" << id );
+				break;
+			default:
+				break;
+		}
+	}
+	delete loaded;
+	delete flat;
+}
+
+/**
+ * Checks that corrupted forms of the tree of the source are rejected.
+ */
+static void testCorrupted(SourceBuffer* source) {
+	FlatAST* flat = flatten(source);
+	string bytes;
+	flat->toBytes(bytes);
+	delete flat;
+
+	for ( size_t size = 0; size < bytes.size(); size++ ) {
+		CHECK( rejected( bytes.substr(0, size) ), "truncated to " << size << " bytes" );
+	}
+	CHECK( rejected( bytes + string(4, '\0') ), "4 bytes appended" );
+
+	// Every bit of the header, and some of the arrays
+	for ( size_t bit = 0; bit < HEADER_SIZE * 8; bit++ ) {
+		string flipped = bytes;
+		flipped[bit / 8] ^= 1 << ( bit % 8 );
+		CHECK( rejected(flipped), "bit " << bit << " flipped" );
+	}
+	for ( size_t i = 0; i < 1000; i++ ) {
+		size_t bit = HEADER_SIZE * 8 + rnd( ( bytes.size() - HEADER_SIZE ) * 8 );
+		string flipped = bytes;
+		flipped[bit / 8] ^= 1 << ( bit % 8 );
+		CHECK( rejected(flipped), "bit " << bit << " flipped" );
+	}
+
+	// Valid checksums, so that the version and the indexes are checked
+	string resealed = bytes;
+	seal(resealed);
+	CHECK( resealed == bytes, "the checksum is not a CRC-32" );
+
+	string version = bytes;
+	put( version, VERSION_AT, get(version, VERSION_AT) - 1 );
+	seal(version);
+	CHECK( rejected(version), "an older version" );
+
+	// The first link, after the kinds, firsts, counts and values of the nodes
+	uint32_t nodes = get(bytes, NODES_AT);
+	size_t links = HEADER_SIZE + ( ( nodes * sizeof(NodeKind) + 3 ) & ~(size_t) 3 ) + 3 * nodes * sizeof(uint32_t);
+	string child = bytes;
+	put( child, links, nodes );
+	seal(child);
+	CHECK( rejected(child), "a child index out of bounds" );
+
+	string kind = bytes;
+	put( kind, HEADER_SIZE, NK_COUNT );
+	seal(kind);
+	CHECK( rejected(kind), "a node kind out of bounds" );
+
+	string first = bytes;
+	put( first, links - 3 * nodes * sizeof(uint32_t), 0xFFFFFFF0 );
+	seal(first);
+	CHECK( rejected(first), "children out of bounds" );
+}
+
+/**
+ * Checks that a corrupted cache file, or one of another source, is a miss, and that
+ * parsing writes the tree again.
+ */
+static void testCache(SourceBuffer* source, SourceBuffer* other) {
+	string directory = "flat-ast-test.cache";
+	CHECK( system( ( "rm -rf " + directory ).c_str() ) == 0, "cannot remove " << directory );
+	ASTCache cache(directory);
+	FlatAST* tree = flatten(source);
+	string expected = tree->toString();
+	delete tree;
+
+	CHECK( cache.load(source) == NULL, "a hit in an empty cache" );
+	FlatAST* flat = cache.parse(source);
+	CHECK( flat->toString() == expected, "the tree of a miss differs" );
+	delete flat;
+	flat = cache.load(source);
+	CHECK( flat != NULL && flat->toString() == expected, "the stored tree differs" );
+	delete flat;
+
+	// A flipped byte in the middle of the file
+	string path = cache.pathOf(source);
+	FILE* file = fopen( path.c_str(), "r+b" );
+	CHECK( file != NULL, "cannot open " << path );
+	if ( file == NULL ) {
+		return;
+	}
+	fseek( file, 0, SEEK_END );
+	long size = ftell(file);
+	fseek( file, size / 2, SEEK_SET );
+	int c = fgetc(file);
+	fseek( file, size / 2, SEEK_SET );
+	fputc( c ^ 0x10, file );
+	fclose(file);
+	CHECK( cache.load(source) == NULL, "a corrupted file is a hit" );
+
+	flat = cache.parse(source);
+	CHECK( flat->toString() == expected, "the tree of a corrupted file differs" );
+	delete flat;
+	flat = cache.load(source);
+	CHECK( flat != NULL && flat->toString() == expected, "the corrupted file is not written again" );
+	delete flat;
+
+	// The file of another source, as if their hashes and sizes collided
+	string command = "cp " + cache.pathOf(other) + " " + path;
+	delete cache.parse(other);
+	CHECK( system( command.c_str() ) == 0, command );
+	CHECK( cache.load(source) == NULL, "the file of another source is a hit" );
+	flat = cache.parse(source);
+	CHECK( flat->toString() == expected, "the tree of a colliding file differs" );
+	delete flat;
+
+	CHECK( system( ( "rm -rf " + directory ).c_str() ) == 0, "cannot remove " << directory );
+}
+
+int main(int argc, char** argv) {
+	if ( argc < 2 ) {
+		cerr << "Usage: flat-ast-test <path>" << endl;
+		return 2;
+	}
+	SourceBuffer* file = SourceBuffer::fromFile(argv[1]);
+	SourceBuffer literals(LITERALS);
+
+	testRoundTrip( file, argv[1] );
+	testRoundTrip( &literals, "literals" );
+	testCorrupted(file);
+	testCorrupted(&literals);
+	testCache( file, &literals );
+
+	delete file;
+	return checkResult();
+}
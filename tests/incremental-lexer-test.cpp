@@ -0,0 +1,105 @@
+#include <iostream>
+#include <string>
+#include "lexer.h"
+#include "incremental-lexer.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * Incremental lexer test.
+ * Applies chains of random edits to a source with an IncrementalLexer, and checks after
+ * each edit that its tokens, and whether it failed, are those of lexing the edited
+ * source from scratch. The edits include text that opens or closes comments and
+ * strings, so that the lexer must go on past the edit until the tokens agree again.
+ * Edits that make the source fail to lex, and half of the others, are undone by the
+ * next edit, so that the source does not stop lexing on an error for good.
+ *
+ *	incremental-lexer-test <path>
+ */
+
+// Number of edit chains, and of edits in each
+static const size_t CHAINS = 10;
+static const size_t EDITS = 400;
+// Number of copies of the source edited
+static const size_t COPIES = 8;
+
+// Inserted text
+static const char* const INSERTS[] = {
+	"x", "12", "3.5", "1.5e", "+7", "\"s\"", "'c'", "\n", "\t", " ", "{", "and", "_",
+	"/*", "*/", "//", "// c\n", "/* a */", "\"", "\\", "'", "\"a\\\"b\""
+};
+
+static uint32_t seed = 777;
+
+static uint32_t rnd(uint32_t n) {
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 16 ) % n;
+}
+
+/**
+ * Checks the tokens of the incremental lexer against a full relex of its source.
+ */
+static void compare(IncrementalLexer& incremental, const string& context) {
+	SourceBuffer* source = incremental.getSource();
+	SourceBuffer copy( string( source->data(), source->size() ) );
+	Lexer full(&copy);
+	full.setQuiet(true);
+	full.generateTokens();
+
+	vector<Token>& a = incremental.getTokens();
+	vector<Token>& b = full.getTokens();
+	CHECK( incremental.hasFailed() == full.hasFailed(), context );
+	CHECK( a.size() == b.size(), context << ": " << a.size() << " tokens instead of " << b.size() );
+	for ( size_t i = 0; i < a.size() && i < b.size(); i++ ) {
+		if ( a[i].getType() != b[i].getType() || a[i].getSubtype() != b[i].getSubtype()
+				|| a[i].getOffset() != b[i].getOffset() || a[i].getLength() != b[i].getLength() ) {
+			CHECK( false, context << ": token #" << i << " is " << a[i].toString(source) << " instead of " << b[i].toString(&copy) );
+			break;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	if ( argc < 2 ) {
+		cerr << "Usage: incremental-lexer-test <path>" << endl;
+		return 2;
+	}
+	SourceBuffer* file = SourceBuffer::fromFile(argv[1]);
+	string text;
+	for ( size_t i = 0; i < COPIES; i++ ) {
+		text.append( file->data(), file->size() );
+	}
+	delete file;
+	CHECK( !text.empty(), "cannot read " << argv[1] );
+
+	size_t failed = 0;
+	for ( size_t chain = 0; chain < CHAINS; chain++ ) {
+		IncrementalLexer incremental( new SourceBuffer(text), true );
+		compare( incremental, "chain " + to_string(chain) );
+		// The last edit, to undo
+		size_t offset = 0;
+		string removed, inserted;
+		bool undo = false;
+		for ( size_t i = 0; i < EDITS; i++ ) {
+			SourceBuffer* source = incremental.getSource();
+			if ( undo ) {
+				swap( removed, inserted );
+			} else {
+				offset = rnd( source->size() + 1 );
+				size_t length = ( rnd(4) == 0 )? rnd(10) : 0;
+				length = min( length, source->size() - offset );
+				removed = string( source->data() + offset, length );
+				inserted = ( rnd(4) == 0 )? "" : INSERTS[ rnd( sizeof(INSERTS) / sizeof(*INSERTS) ) ];
+			}
+			incremental.applyEdit( offset, removed.length(), inserted );
+			compare( incremental, "chain " + to_string(chain) + ", edit " + to_string(i) + " at " + to_string(offset)
+				+ " of [" + removed + "] into [" + inserted + "]" );
+			failed += incremental.hasFailed();
+			undo = !undo && ( incremental.hasFailed() || rnd(2) == 0 );
+		}
+	}
+	// The edits must not all leave sources that fail to lex
+	CHECK( failed < CHAINS * EDITS / 2, failed << " of " << CHAINS * EDITS << " edited sources failed to lex" );
+	return checkResult();
+}
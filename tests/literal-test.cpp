@@ -0,0 +1,237 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include "literal.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * Literal decoding test.
+ * Checks LiteralDecoder against tables of images: the bits of reals against those of
+ * strtod(), by Clinger's fast path and by the fallback, integers up to INT64_MAX and
+ * past it, every escape sequence of characters and strings, and the offset of each
+ * error.
+ *
+ *	literal-test
+ */
+
+struct IntegerCase {
+	const char* image;
+	LiteralError error;
+	int64_t value;
+};
+
+static const IntegerCase INTEGERS[] = {
+	{ "0", LE_NONE, 0 },
+	{ "42", LE_NONE, 42 },
+	{ "999999999999999999", LE_NONE, 999999999999999999LL },
+	{ "1000000000000000000", LE_NONE, 1000000000000000000LL },
+	{ "00000000000000000000001", LE_NONE, 1 },
+	{ "9223372036854775807", LE_NONE, INT64_MAX },
+	{ "9223372036854775808", LE_INTEGER_RANGE, 0 },
+	{ "9223372036854775810", LE_INTEGER_RANGE, 0 },
+	{ "18446744073709551616", LE_INTEGER_RANGE, 0 },
+	{ "99999999999999999999999", LE_INTEGER_RANGE, 0 },
+};
+
+struct RealCase {
+	const char* image;
+	LiteralError error;
+	// The offset of the error
+	size_t at;
+};
+
+static const RealCase REALS[] = {
+	// Fast path
+	{ "0.0", LE_NONE, 0 },
+	{ "1.5", LE_NONE, 0 },
+	{ "0.1", LE_NONE, 0 },
+	{ "3.14159", LE_NONE, 0 },
+	{ "1.0e22", LE_NONE, 0 },
+	{ "1.0e23", LE_NONE, 0 },
+	{ "123.0e25", LE_NONE, 0 },
+	{ "9007199254740992.0", LE_NONE, 0 },
+	{ "1.5e-22", LE_NONE, 0 },
+	{ "2.5E+3", LE_NONE, 0 },
+	{ "000.000125", LE_NONE, 0 },
+	// Fallback: more than 53 bits of mantissa, exponents past the exact powers, or
+	// more than 19 significant digits
+	{ "9007199254740993.0", LE_NONE, 0 },
+	{ "0.30000000000000004", LE_NONE, 0 },
+	{ "123.0e-30", LE_NONE, 0 },
+	{ "1.0e-23", LE_NONE, 0 },
+	{ "1.7976931348623157e308", LE_NONE, 0 },
+	{ "2.2250738585072014e-308", LE_NONE, 0 },
+	{ "4.9e-324", LE_NONE, 0 },
+	{ "1.0e-400", LE_NONE, 0 },
+	{ "1.00000000000000000000001", LE_NONE, 0 },
+	{ "123456789012345678901234567890.0", LE_NONE, 0 },
+	{ "0.1000000000000000055511151231257827", LE_NONE, 0 },
+	// Errors
+	{ "1.0e400", LE_REAL_RANGE, 0 },
+	{ "1.8e308", LE_REAL_RANGE, 0 },
+	{ "1.0e99999999", LE_REAL_RANGE, 0 },
+	{ "1.5e+", LE_EXPONENT, 5 },
+	{ "1.5e-", LE_EXPONENT, 5 },
+	{ "1.5e", LE_EXPONENT, 4 },
+};
+
+struct FastCase {
+	uint64_t mantissa;
+	int exponent;
+	// Whether the fast path finds the value
+	bool exact;
+};
+
+static const FastCase FAST[] = {
+	{ 15, -1, true },
+	{ 1, 22, true },
+	{ 1, 23, true },
+	{ 123, 25, true },
+	{ 9007199254740992ULL, 0, true },
+	{ 9007199254740993ULL, 0, false },
+	{ 1, -22, true },
+	{ 1, -23, false },
+	{ 0, 400, true },
+	{ 900719925474099ULL, 23, true },
+	{ 900719925474100ULL, 23, false },
+};
+
+struct EscapeCase {
+	char escape;
+	int value;
+};
+
+static const EscapeCase ESCAPES[] = {
+	{ 'n', '\n' }, { 't', '\t' }, { 'r', '\r' }, { '0', '\0' }, { '\\', '\\' }, { '\'', '\'' }, { '"', '"' },
+	{ 'q', -1 }, { 'x', -1 }, { 'N', -1 }, { ' ', -1 }, { '1', -1 },
+};
+
+struct StringCase {
+	const char* image;
+	LiteralError error;
+	// The characters, with escapes replaced, or the offset of the error
+	const char* value;
+	size_t at;
+};
+
+static const StringCase STRINGS[] = {
+	{ "\"\"", LE_NONE, "", 0 },
+	{ "\"plain\"", LE_NONE, "plain", 0 },
+	{ "\"a\\nb\"", LE_NONE, "a\nb", 0 },
+	{ "\"\\n\\t\\r\\\\\\'\\\"\"", LE_NONE, "\n\t\r\\'\"", 0 },
+	{ "\"\\\\n\"", LE_NONE, "\\n", 0 },
+	{ "\"\\q\"", LE_ESCAPE, NULL, 1 },
+	{ "\"ab\\nc\\x\"", LE_ESCAPE, NULL, 6 },
+};
+
+static string bits(double d) {
+	char buffer[64];
+	uint64_t b;
+	memcpy( &b, &d, sizeof(b) );
+	snprintf( buffer, sizeof(buffer), "%.17g (%016llx)", d, (unsigned long long) b );
+	return buffer;
+}
+
+static void testIntegers() {
+	for ( const IntegerCase& c : INTEGERS ) {
+		int64_t value = -1;
+		size_t at = 99;
+		LiteralError error = LiteralDecoder::decodeInteger( c.image, strlen(c.image), &value, &at );
+		CHECK( error == c.error, c.image << ": " << literalErrorName(error) );
+		if ( error == LE_NONE ) {
+			CHECK( value == c.value, c.image << ": " << value );
+		} else {
+			CHECK( at == 0, c.image << ": error at " << at );
+		}
+	}
+}
+
+static void testReals() {
+	for ( const RealCase& c : REALS ) {
+		double value = -1;
+		size_t at = 99;
+		LiteralError error = LiteralDecoder::decodeReal( c.image, strlen(c.image), &value, &at );
+		CHECK( error == c.error, c.image << ": " << literalErrorName(error) );
+		if ( error == LE_NONE ) {
+			double expected = strtod( c.image, NULL );
+			CHECK( memcmp( &value, &expected, sizeof(value) ) == 0, c.image << ": " << bits(value) << " instead of " << bits(expected) );
+		} else {
+			CHECK( at == c.at, c.image << ": error at " << at );
+		}
+	}
+
+	for ( const FastCase& c : FAST ) {
+		char image[64];
+		snprintf( image, sizeof(image), "%llue%d", (unsigned long long) c.mantissa, c.exponent );
+		double value = -1;
+		bool exact = LiteralDecoder::fastReal( c.mantissa, c.exponent, &value );
+		CHECK( exact == c.exact, image << ": " << ( exact? "fast" : "not fast" ) );
+		if ( exact ) {
+			double expected = strtod( image, NULL );
+			CHECK( memcmp( &value, &expected, sizeof(value) ) == 0, image << ": " << bits(value) << " instead of " << bits(expected) );
+		}
+	}
+}
+
+static void testChars() {
+	char value = 0;
+	size_t at = 99;
+	CHECK( LiteralDecoder::decodeChar( "'a'", 3, &value, &at ) == LE_NONE && value == 'a', "'a'" );
+	CHECK( LiteralDecoder::decodeChar( "'\\'", 3, &value, &at ) == LE_NONE && value == '\\', "'\\'" );
+
+	for ( const EscapeCase& c : ESCAPES ) {
+		CHECK( LiteralDecoder::escape(c.escape) == c.value, "\\" << c.escape );
+		char image[] = { '\'', '\\', c.escape, '\'' };
+		value = 'z';
+		at = 99;
+		LiteralError error = LiteralDecoder::decodeChar( image, 4, &value, &at );
+		if ( c.value < 0 ) {
+			CHECK( error == LE_ESCAPE && at == 1, "'\\" << c.escape << "': " << literalErrorName(error) << " at " << at );
+		} else {
+			CHECK( error == LE_NONE && value == c.value, "'\\" << c.escape << "': " << literalErrorName(error) );
+		}
+	}
+}
+
+static void testStrings() {
+	Arena arena;
+	for ( const StringCase& c : STRINGS ) {
+		size_t length = strlen(c.image);
+		Literal value = Literal();
+		size_t at = 99;
+		LiteralError error = LiteralDecoder::decodeString( c.image, length, &arena, &value, &at );
+		CHECK( error == c.error, c.image << ": " << literalErrorName(error) );
+		if ( error != LE_NONE ) {
+			CHECK( at == c.at, c.image << ": error at " << at );
+			continue;
+		}
+		// Without escapes, the characters are those of the image
+		const char* text = ( value.text != NULL )? value.text : c.image + 1;
+		CHECK( ( value.text == NULL ) == ( memchr( c.image, '\\', length ) == NULL ), c.image );
+		CHECK( string(text, value.length) == c.value, c.image << ": [" << string(text, value.length) << "]" );
+	}
+
+	// Every escape
+	for ( const EscapeCase& c : ESCAPES ) {
+		string image = string("\"a\\") + c.escape + "b\"";
+		Literal value = Literal();
+		size_t at = 99;
+		LiteralError error = LiteralDecoder::decodeString( image.data(), image.length(), &arena, &value, &at );
+		if ( c.value < 0 ) {
+			CHECK( error == LE_ESCAPE && at == 2, image << ": " << literalErrorName(error) << " at " << at );
+		} else {
+			CHECK( error == LE_NONE && value.length == 3 && string(value.text, 3) == string("a") + (char) c.value + "b", image );
+		}
+	}
+}
+
+int main() {
+	testIntegers();
+	testReals();
+	testChars();
+	testStrings();
+	return checkResult();
+}
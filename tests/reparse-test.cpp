@@ -0,0 +1,165 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "lexer.h"
+#include "parser.h"
+#include "incremental-lexer.h"
+#include "ast-writer.h"
+#include "check.h"
+
+using namespace std;
+
+/**
+ * Incremental reparsing test.
+ * Applies random edits to a source with an IncrementalLexer, updates the tree with
+ * Parser::reparse(), and checks that the printed tree, and the tokens recorded by every
+ * statement and block, are those of parsing the edited source from scratch, or that
+ * both fail. This is done in each mode of the parser. In lazy mode, the bodies of
+ * functions are parsed before comparing: a reparse parses the body of an edited
+ * function, where parsing from scratch leaves it an empty block.
+ *
+ *	reparse-test <path>
+ */
+
+// Number of edits in each mode
+static const size_t EDITS = 300;
+// Number of copies of the source edited
+static const size_t COPIES = 4;
+
+// Inserted text
+static const char* const INSERTS[] = {
+	"x", "1", "+ y", "write z;\n", "let q : int = 5;\n", "{", "}", ";", "(", " ", "\n",
+	"if ( a ) { write a; }\n", "while ( b ) { write b; }\n", "function g ( ) : int { 1; }\n"
+};
+
+static const char* const MODES[] = { "backtracking", "predictive", "climbing", "packrat", "lazy" };
+enum Mode { BACKTRACKING, PREDICTIVE, CLIMBING, PACKRAT, LAZY, MODE_COUNT };
+
+static uint32_t seed = 2024;
+
+static uint32_t rnd(uint32_t n) {
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 16 ) % n;
+}
+
+static void setMode(Parser& parser, Mode mode) {
+	parser.setPredictive( mode == PREDICTIVE || mode == CLIMBING );
+	parser.setPrecedenceClimbing( mode == CLIMBING );
+	parser.setPackrat( mode == PACKRAT );
+	parser.setLazy( mode == LAZY );
+}
+
+/**
+ * Returns the tree as text, followed by the tokens of each statement and block, after
+ * parsing the bodies of functions skipped in lazy mode.
+ */
+static string print(Parser& parser, ASTNode* tree) {
+	stringstream ranges;
+	vector<ASTNode*> stack(1, tree);
+	while ( !stack.empty() ) {
+		ASTNode* node = stack.back();
+		stack.pop_back();
+		if ( node->getKind() == NK_FUNC_DECL ) {
+			parser.parseBody( static_cast<FuncDeclNode*>(node) );
+		}
+		if ( node->hasTokens() ) {
+			ranges << node->getName() << " [" << node->getTokenBegin() << ", " << node->getTokenEnd() << ", " << node->getTokenReach() << ")\n";
+		}
+		for ( uint32_t i = node->getChildCount(); i > 0; i-- ) {
+			stack.push_back( node->getChild(i - 1) );
+		}
+	}
+	return tree->toString() + ranges.str();
+}
+
+/**
+ * Parses the source from scratch. Returns false if it has a syntax error.
+ */
+static bool parse(SourceBuffer* source, Mode mode, string* printed) {
+	Lexer lexer(source);
+	lexer.setQuiet(true);
+	lexer.generateTokens();
+	Parser parser(&lexer);
+	setMode(parser, mode);
+	try {
+		*printed = print( parser, parser.parseSXL() );
+		return true;
+	} catch( ParseException &e ) {
+		return false;
+	}
+}
+
+static void test(const string& text, Mode mode) {
+	IncrementalLexer incremental( new SourceBuffer(text), true );
+	Parser parser( incremental.getLexer() );
+	setMode(parser, mode);
+	ASTNode* tree = parser.parseSXL();
+	size_t reparsed = 0;
+
+	for ( size_t i = 0; i < EDITS; i++ ) {
+		SourceBuffer* source = incremental.getSource();
+		size_t offset = rnd( source->size() + 1 );
+		size_t length = ( rnd(3) == 0 )? rnd(20) : 0;
+		length = min( length, source->size() - offset );
+		string removed( source->data() + offset, length );
+		string inserted = ( rnd(4) == 0 )? "" : INSERTS[ rnd( sizeof(INSERTS) / sizeof(*INSERTS) ) ];
+		string context = string(MODES[mode]) + ", edit " + to_string(i) + " at " + to_string(offset)
+			+ " of [" + removed + "] into [" + inserted + "]";
+
+		TokenEdit edit = incremental.applyEdit( offset, removed.length(), inserted );
+		parser.setLexer( incremental.getLexer() );
+		SourceBuffer copy( string( incremental.getSource()->data(), incremental.getSource()->size() ) );
+		string expected;
+		bool parsed = parse(&copy, mode, &expected);
+
+		ASTNode* updated = NULL;
+		string printed;
+		bool reparsedOk = false;
+		try {
+			updated = parser.reparse(tree, edit);
+			// In lazy mode, a body may still have a syntax error
+			printed = print(parser, updated);
+			reparsedOk = true;
+		} catch( ParseException &e ) {}
+		CHECK( parsed == reparsedOk, context << ": " << ( parsed? "reparse failed" : "reparse did not fail" ) );
+		CHECK( !parsed || !reparsedOk || printed == expected, context << ": the trees differ" );
+
+		if ( reparsedOk ) {
+			tree = updated;
+			reparsed++;
+			continue;
+		}
+		// Undo the edit. If the reparse failed, the old tree holds again. Otherwise
+		// it shares the nodes of the new one, which is reparsed back.
+		TokenEdit undo = incremental.applyEdit( offset, inserted.length(), removed );
+		parser.setLexer( incremental.getLexer() );
+		if ( updated != NULL ) {
+			try {
+				tree = parser.reparse(updated, undo);
+			} catch( ParseException &e ) {
+				CHECK( false, context << ": undoing the edit failed" );
+				return;
+			}
+		}
+	}
+	// The edits must not all leave sources with syntax errors
+	CHECK( reparsed > EDITS / 4, MODES[mode] << ": only " << reparsed << " of " << EDITS << " edits reparsed" );
+}
+
+int main(int argc, char** argv) {
+	if ( argc < 2 ) {
+		cerr << "Usage: reparse-test <path>" << endl;
+		return 2;
+	}
+	SourceBuffer* file = SourceBuffer::fromFile(argv[1]);
+	string text;
+	for ( size_t i = 0; i < COPIES; i++ ) {
+		text.append( file->data(), file->size() );
+	}
+	delete file;
+
+	for ( int mode = BACKTRACKING; mode < MODE_COUNT; mode++ ) {
+		test( text, (Mode) mode );
+	}
+	return checkResult();
+}
@@ -0,0 +1,98 @@
+#ifndef __TOKEN_WINDOW_H__
+#define __TOKEN_WINDOW_H__
+
+#include <vector>
+#include <new>
+#include "token.h"
+
+using namespace std;
+
+/**
+ * The TokenWindow class.
+ * A bounded window over a stream of tokens, addressed by absolute token index.
+ * Tokens are stored in fixed-size blocks that are used as a ring: blocks that fall
+ * out of the window are recycled for new tokens. Memory stays proportional to the
+ * window size, and a token keeps its address for as long as it is in the window.
+ */
+class TokenWindow {
+	private:
+		// Number of tokens per block
+		static const size_t BLOCK_SIZE = 256;
+		// The blocks in the window, oldest first
+		vector<Token*> blocks;
+		// Blocks that fell out of the window, ready to be reused
+		vector<Token*> spare;
+		// Absolute index of the first token of the first block
+		size_t first;
+		// Absolute index one past the last token
+		size_t last;
+
+		TokenWindow(const TokenWindow&) = delete;
+		TokenWindow& operator=(const TokenWindow&) = delete;
+
+	public:
+		TokenWindow() {
+			this->first = 0;
+			this->last = 0;
+		}
+
+		~TokenWindow() {
+			for ( size_t i = 0; i < this->blocks.size(); i++ ) {
+				::operator delete(this->blocks[i]);
+			}
+			for ( size_t i = 0; i < this->spare.size(); i++ ) {
+				::operator delete(this->spare[i]);
+			}
+		}
+
+		/** Returns the index of the oldest token still in the window. */
+		size_t begin() {
+			return this->first;
+		}
+
+		/** Returns the index one past the newest token in the window. */
+		size_t end() {
+			return this->last;
+		}
+
+		/** Returns whether the token at the given index is in the window. */
+		bool contains(size_t i) {
+			return i >= this->first && i < this->last;
+		}
+
+		/** Returns the token at the given index, which must be in the window. */
+		Token* at(size_t i) {
+			i -= this->first;
+			return &this->blocks[i / BLOCK_SIZE][i % BLOCK_SIZE];
+		}
+
+		/** Appends a token to the window. */
+		void push(const Token& token) {
+			// Add a block if the last one is full
+			if ( this->last - this->first == this->blocks.size() * BLOCK_SIZE ) {
+				if ( !this->spare.empty() ) {
+					this->blocks.push_back( this->spare.back() );
+					this->spare.pop_back();
+				} else {
+					this->blocks.push_back( (Token*) ::operator new(BLOCK_SIZE * sizeof(Token)) );
+				}
+			}
+			new ( this->at(this->last) ) Token(token);
+			this->last++;
+		}
+
+		/**
+		 * Drops tokens before the given index from the window.
+		 * Tokens are dropped a whole block at a time, so some may stay reachable.
+		 */
+		void discardBefore(size_t i) {
+			while ( !this->blocks.empty() && this->first + BLOCK_SIZE <= i && this->first + BLOCK_SIZE <= this->last ) {
+				this->spare.push_back( this->blocks.front() );
+				this->blocks.erase( this->blocks.begin() );
+				this->first += BLOCK_SIZE;
+			}
+		}
+};
+
+
+#endif
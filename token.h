@@ -3,63 +3,134 @@
 
 #include <string>
 #include <sstream>
+#include <cstdint>
 #include "tokentype.h"
+#include "symbol-table.h"
+#include "source-buffer.h"
 
 using namespace std;
 
-/** 
+/**
  * The Token class.
- * Represents a single token, with a type and a string of matched characters (image).
+ * Represents a single token, with a type and the range of matched characters (image)
+ * in the source buffer. The image itself is not copied into the token, and neither is
+ * its row and column, which are found from the offset when needed (see LineTable).
  */
 class Token {
 	private:
+		/** Offset of the image in the source buffer */
+		uint32_t offset;
+		/** Length of the image */
+		uint32_t length;
 		/** Token type */
-		string type;
-		/** Token image */
-		string image;
-		/** Row where matched string was found in file */
-		int row;
-		/** Column where matched string was found in file */
-		int col;
+		TokenType type;
+		/** Token subtype (operator or keyword) */
+		TokenSubtype subtype;
+		/**
+		 * Symbol ID of identifiers (see SymbolTable), or index of the value of literals,
+		 * which have no symbol (see Lexer::getLiteral())
+		 */
+		uint32_t symbol;
 
 	public:
 		/** Constructor */
-		Token(string type, string image, int row, int col) {
+		Token(TokenType type, TokenSubtype subtype, uint32_t offset, uint32_t length) {
 			this->type = type;
-			this->image = image;
-			this->row = row;
-			this->col = col;
+			this->subtype = subtype;
+			this->offset = offset;
+			this->length = length;
+			this->symbol = NO_SYMBOL;
+		}
+		Token(TokenType type, uint32_t offset, uint32_t length) {
+			this->type = type;
+			this->subtype = ST_NONE;
+			this->offset = offset;
+			this->length = length;
+			this->symbol = NO_SYMBOL;
 		}
 		Token ( Token* t ) {
 			this->type = t->type;
-			this->image = t->image;
-			this->row = t->row;
-			this->col = t->col;
+			this->subtype = t->subtype;
+			this->offset = t->offset;
+			this->length = t->length;
+			this->symbol = t->symbol;
 		}
 
 		/** Returns the token type. */
-		string getType() {
+		TokenType getType() {
 			return this->type;
 		}
 
-		/** Returns the token image. */
-		string getImage() {
-			return this->image;
+		/** Returns the token subtype. */
+		TokenSubtype getSubtype() {
+			return this->subtype;
+		}
+
+		/** Checks if the token has the given type and subtype. */
+		bool is(TokenType type, TokenSubtype subtype) {
+			return this->type == type && this->subtype == subtype;
+		}
+
+		/** Returns the symbol ID of the token, or NO_SYMBOL. */
+		uint32_t getSymbol() {
+			return this->symbol;
+		}
+		/** Sets the symbol ID of the token. */
+		void setSymbol(uint32_t symbol) {
+			this->symbol = symbol;
+		}
+
+		/** Returns the index of the value of a literal token. */
+		uint32_t getLiteral() {
+			return this->symbol;
+		}
+		/** Sets the index of the value of a literal token. */
+		void setLiteral(uint32_t index) {
+			this->symbol = index;
+		}
+
+		/** Returns the offset of the token image in the source buffer. */
+		uint32_t getOffset() {
+			return this->offset;
 		}
 
-		/** Returns the row position. */
-		int getRow() {
-			return this->row;
+		/** Returns the length of the token image. */
+		uint32_t getLength() {
+			return this->length;
 		}
 
-		/** Returns the column position. */
-		int getCol() {
-			return this->col;
+		/** Returns the token image, read from the given source buffer. */
+		string getImage(const char* source) {
+			if ( this->type == TK_EOF ) {
+				return "eof";
+			}
+			if ( this->length == 0 ) {
+				return "";
+			}
+			return string(source + this->offset, this->length);
 		}
 
-		/** Checks if the token is a null token (indicated by an empty type) */
+		/** Returns the row of the token in the given source. */
+		int getRow(SourceBuffer* source) {
+			return source->getRow(this->offset);
+		}
+
+		/** Returns the column of the token in the given source. */
+		int getCol(SourceBuffer* source) {
+			return source->getCol(this->offset);
+		}
+
+		/**
+		 * Moves the token by the given number of characters, after an edit of the source
+		 * before it.
+		 */
+		void shift(int64_t offset) {
+			this->offset += offset;
+		}
+
+		/** Checks if the token is a null token */
 		bool isNullToken() {
-			return this->type.length() == 0;
+			return this->type == TK_NONE;
 		}
 
 		/** Checks if the token is an EOF token */
@@ -67,26 +138,25 @@ class Token {
 			return this->type == TK_EOF;
 		}
 
-		string getPosition() { 
+		/** Checks if the token has a literal value (see getLiteral()) */
+		bool hasLiteral() {
+			return this->type == TK_INTEGER || this->type == TK_REAL || this->type == TK_CHAR || this->type == TK_STRING;
+		}
+
+		/** Returns the position of the token in the given source, for messages. */
+		string getPosition(SourceBuffer* source) {
 			stringstream ss;
-			ss << "line#" << this->row << ":" << this->col;
+			ss << "line#" << this->getRow(source) << ":" << this->getCol(source);
 			return ss.str();
 		}
 
 		/** Used internally to print the token. */
-		string toString() {
+		string toString(SourceBuffer* source) {
 			stringstream ss;
-			ss << "<" << this->type << "> " << this->image << " at " << getPosition();
+			ss << "<" << tokenTypeName(this->type) << "> " << this->getImage( source->data() ) << " at " << this->getPosition(source);
 			return ss.str();
 		}
-
-		static Token* nullToken() {
-			return Token::nullToken(0,0);
-		}
-		static Token* nullToken(int row, int col) {
-			return new Token("","",row,col);
-		}
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -1,31 +1,113 @@
 #ifndef __H_TOKENTYPE__
 #define __H_TOKENTYPE__
 
-// Identifiers and keywords
-#define TK_KEYWORD			"TK_KEYWORD"
-#define TK_IDENTIFIER		"TK_IDENTIFIER"
-// Literals
-#define TK_INTEGER			"TK_INTEGER"
-#define TK_REAL				"TK_REAL"
-#define TK_CHAR				"TK_CHAR"
-#define TK_STRING			"TK_STRING"
-#define TK_BOOL				"TK_BOOL"
-#define TK_UNIT				"TK_UNIT"
-// Operators
-#define TK_ADD_OP			"TK_ADD_OP"
-#define TK_MULT_OP			"TK_MULT_OP"
-#define TK_REL_OP			"TK_REL_OP"
-#define TK_EQUALS_OP		"TK_EQUALS_OP"
-#define TK_ASSIGN_OP		"TK_ASSIGN_OP"
-// Syntax Symbols
-#define TK_COMMA			"TK_COMMA"
-#define TK_COLON			"TK_COLON"
-#define TK_SEMICOLON		"TK_SEMICOLON"
-#define TK_OPEN_PAREN		"TK_OPEN_PAREN"
-#define TK_CLOSE_PAREN		"TK_CLOSE_PAREN"
-#define TK_OPEN_BLOCK		"TK_OPEN_BLOCK"
-#define TK_CLOSE_BLOCK		"TK_CLOSE_BLOCK"
-// EOF TOKEN
-#define TK_EOF				"TK_EOF"
+/**
+ * Token types
+ */
+enum TokenType : unsigned char {
+	// Identifiers and keywords
+	TK_KEYWORD,
+	TK_IDENTIFIER,
+	// Literals
+	TK_INTEGER,
+	TK_REAL,
+	TK_CHAR,
+	TK_STRING,
+	TK_BOOL,
+	TK_UNIT,
+	// Operators
+	TK_ADD_OP,
+	TK_MULT_OP,
+	TK_REL_OP,
+	TK_EQUALS_OP,
+	TK_ASSIGN_OP,
+	// Syntax Symbols
+	TK_COMMA,
+	TK_COLON,
+	TK_SEMICOLON,
+	TK_OPEN_PAREN,
+	TK_CLOSE_PAREN,
+	TK_OPEN_BLOCK,
+	TK_CLOSE_BLOCK,
+	// EOF TOKEN
+	TK_EOF,
+	// No token matched (null token)
+	TK_NONE
+};
+
+/**
+ * Token subtypes.
+ * Tells apart the operators and keywords that share a token type, so that they can
+ * be told apart without looking at the token image.
+ */
+enum TokenSubtype : unsigned char {
+	ST_NONE,
+	// Additive operators
+	OP_PLUS,
+	OP_MINUS,
+	OP_OR,
+	// Multiplicative operators
+	OP_MULT,
+	OP_DIV,
+	OP_AND,
+	// Relational operators
+	OP_LT,
+	OP_GT,
+	OP_LE,
+	OP_GE,
+	OP_EQ,
+	OP_NE,
+	// Keywords
+	KW_FUNCTION,
+	KW_IF,
+	KW_WHILE,
+	KW_HALT,
+	KW_IN,
+	KW_NOT,
+	KW_READ,
+	KW_WRITE,
+	KW_SET,
+	KW_LET,
+	// Type keywords
+	KW_INT,
+	KW_REAL,
+	KW_CHAR,
+	KW_STRING,
+	KW_BOOL,
+	KW_UNIT,
+	// Boolean literals
+	KW_TRUE,
+	KW_FALSE
+};
+
+/**
+ * Returns the printable name of the given token type.
+ */
+inline const char* tokenTypeName(TokenType type) {
+	switch( type ) {
+		case TK_KEYWORD:		return "TK_KEYWORD";
+		case TK_IDENTIFIER:		return "TK_IDENTIFIER";
+		case TK_INTEGER:		return "TK_INTEGER";
+		case TK_REAL:			return "TK_REAL";
+		case TK_CHAR:			return "TK_CHAR";
+		case TK_STRING:			return "TK_STRING";
+		case TK_BOOL:			return "TK_BOOL";
+		case TK_UNIT:			return "TK_UNIT";
+		case TK_ADD_OP:			return "TK_ADD_OP";
+		case TK_MULT_OP:		return "TK_MULT_OP";
+		case TK_REL_OP:			return "TK_REL_OP";
+		case TK_EQUALS_OP:		return "TK_EQUALS_OP";
+		case TK_ASSIGN_OP:		return "TK_ASSIGN_OP";
+		case TK_COMMA:			return "TK_COMMA";
+		case TK_COLON:			return "TK_COLON";
+		case TK_SEMICOLON:		return "TK_SEMICOLON";
+		case TK_OPEN_PAREN:		return "TK_OPEN_PAREN";
+		case TK_CLOSE_PAREN:	return "TK_CLOSE_PAREN";
+		case TK_OPEN_BLOCK:		return "TK_OPEN_BLOCK";
+		case TK_CLOSE_BLOCK:	return "TK_CLOSE_BLOCK";
+		case TK_EOF:			return "TK_EOF";
+		default:				return "";
+	}
+}
 
 #endif